@@ -0,0 +1,38 @@
+// Read multiple HX711 devices sharing the same CLK pin
+//
+// - All devices are clocked by the same CLK pin, each has its own DAT pin.
+// - All devices are read at the same time by the MD_HX711Array object.
+// - Display the tared data for each device to serial monitor
+//
+
+#include <MD_HX711.h>
+
+// Define pin connections to HX711 modules
+const uint8_t PIN_CLK = 4;
+const uint8_t PIN_DAT[] = { 2, 3, 5 };
+
+const uint8_t NUM_DEVICES = sizeof(PIN_DAT) / sizeof(PIN_DAT[0]);
+
+MD_HX711Array<NUM_DEVICES> scales(PIN_CLK, PIN_DAT);
+
+void setup(void)
+{
+  Serial.begin(57600);
+  Serial.println("[MD_HX711 Array]");
+
+  scales.begin();
+  scales.autoZeroTare();
+}
+
+void loop(void)
+{
+  MD_HX711::channel_t ch = scales.read();
+
+  Serial.print(ch == MD_HX711::CH_A ? "A:" : "B:");
+  for (uint8_t i = 0; i < NUM_DEVICES; i++)
+  {
+    Serial.print("\t");
+    Serial.print(scales.getTared(i, ch));
+  }
+  Serial.println();
+}
@@ -0,0 +1,210 @@
+// Benchmark the library acquisition and data processing methods
+//
+// No HX711 hardware is needed. The timing of the HX711 protocol is measured
+// by clocking the CLK pin with nothing (or an HX711) connected. Methods that 
+// need data from the HX711 use the MD_HX711_Sim simulated device.
+//
+// For each method the time per call is reported, with the number of CLK 
+// edges counted by the simulator for each read. Run this sketch on each 
+// release to compare the results with previous releases.
+//
+
+#include <MD_HX711.h>
+#include <MD_HX711_Sim.h>
+#include <MD_HX711_Cal.h>
+#include <MD_HX711_Filter.h>
+
+// Define pin connections for the protocol timing
+const uint8_t PIN_DAT = 2;
+const uint8_t PIN_CLK = 4;
+
+const uint16_t LOOPS = 100;     // number of times each method is run
+
+// Expose the protocol method for timing
+class benchHX711 : public MD_HX711
+{
+public:
+  benchHX711(uint8_t pinClk, uint8_t pinDat) : MD_HX711(pinClk, pinDat) {}
+  using MD_HX711::HX711ReadData;
+};
+
+class benchHX711T : public MD_HX711T<PIN_CLK, PIN_DAT>
+{
+public:
+  using MD_HX711T<PIN_CLK, PIN_DAT>::HX711ReadData;
+};
+
+benchHX711 scalePin(PIN_CLK, PIN_DAT);
+benchHX711T scaleFast;
+
+// Simulated device
+MD_HX711_Sim hx711(MD_HX711_Sim::PERIOD_80SPS);
+MD_HX711B<MD_HX711_SimBus> scaleSim((MD_HX711_SimBus(&hx711)));
+
+// Calibration table
+MD_HX711_CalTable::point_t calPoints[8];
+MD_HX711_CalTable calTable(calPoints, 8);
+MD_HX711_CalPoly calPoly;
+
+// Filters
+int32_t avgBuf[16];
+MD_HX711_FilterAvg filterAvg(avgBuf, 16);
+MD_HX711_FilterMedian filterMedian(5);
+MD_HX711_FilterEMA filterEMA(3);
+MD_HX711_FilterBiquad filterBiquad;
+MD_HX711_FilterAdaptive filterAdaptive;
+MD_HX711_FilterNotch filterNotch(50);
+MD_HX711_FilterKalman filterKalman;
+MD_HX711_FilterDecimate filterDecimate(16);
+
+void report(const char *name, uint32_t time, uint16_t loops)
+{
+  Serial.print(name);
+  Serial.print("\t");
+  Serial.print((time * 1000) / loops);
+  Serial.println(" ns/call");
+}
+
+void benchFilter(const char *name, MD_HX711_Filter &f)
+{
+  uint32_t t, ts = 0;
+  int32_t q = 0;
+
+  f.reset();
+  t = micros();
+  for (uint16_t i = 0; i < LOOPS; i++)
+  {
+    q = f.apply(1000 + (i & 0xf), ts);
+    ts += MD_HX711::PERIOD_80SPS;     // timestamps as received at 80 SPS
+  }
+  report(name, micros() - t, LOOPS);
+  Serial.print("(value ");
+  Serial.print(q);
+  Serial.println(")");
+}
+
+void benchProtocol(void)
+{
+  uint32_t t;
+
+  scalePin.begin();
+  t = micros();
+  for (uint16_t i = 0; i < LOOPS; i++)
+    scalePin.HX711ReadData(1);
+  report("MD_HX711::HX711ReadData()", micros() - t, LOOPS);
+
+  scaleFast.begin();
+  t = micros();
+  for (uint16_t i = 0; i < LOOPS; i++)
+    scaleFast.HX711ReadData(1);
+  report("MD_HX711T::HX711ReadData()", micros() - t, LOOPS);
+}
+
+void benchSimulated(void)
+{
+  const uint8_t READS = 10;
+  uint32_t t, total = 0;
+  float f;
+  int32_t q;
+
+  scaleSim.begin();
+  scaleSim.setSamplePeriod(MD_HX711::PERIOD_80SPS);
+  hx711.setInput(false, 100000L);
+  hx711.setInput(true, -50000L);
+
+  // read cycle, excluding the time waiting for data ready
+  hx711.clearStats();
+  for (uint8_t i = 0; i < READS; i++)
+  {
+    while (!scaleSim.isReady()) { yield(); }
+    t = micros();
+    scaleSim.read();
+    total += micros() - t;
+  }
+  report("MD_HX711B<SimBus>::read()", total, READS);
+  Serial.print("CLK edges/read\t");
+  Serial.println(hx711.getEdges() / READS);
+
+  // data processing
+  scaleSim.setZeroTare(1000);
+  scaleSim.setCalibration(200000L, 1000.0);
+
+  t = micros();
+  for (uint16_t i = 0; i < LOOPS; i++)
+    f = scaleSim.getCalibrated();
+  report("getCalibrated()", micros() - t, LOOPS);
+  Serial.print("(value ");
+  Serial.print(f);
+  Serial.println(")");
+
+  t = micros();
+  for (uint16_t i = 0; i < LOOPS; i++)
+    q = scaleSim.getCalibratedFixed();
+  report("getCalibratedFixed()", micros() - t, LOOPS);
+  Serial.print("(value ");
+  Serial.print(q / 65536.0);
+  Serial.println(")");
+
+  t = micros();
+  for (uint16_t i = 0; i < LOOPS; i++)
+    q = scaleSim.getCalibratedInt(MD_HX711::CH_A, 1000);
+  report("getCalibratedInt()", micros() - t, LOOPS);
+  Serial.print("(value ");
+  Serial.print(q);
+  Serial.println(")");
+
+  // calibration table, uneven spacing (binary search)
+  for (uint8_t i = 0; i < 8; i++)
+    calTable.addPoint(i * (30000L + i * 100), i * 125);
+  scaleSim.setCalCurve(&calTable);
+
+  t = micros();
+  for (uint16_t i = 0; i < LOOPS; i++)
+    q = scaleSim.getCalibratedInt();
+  report("getCalibratedInt() CalTable", micros() - t, LOOPS);
+
+  // 3rd order polynomial fitted to the table points
+  {
+    int32_t raw[8], value[8];
+
+    for (uint8_t i = 0; i < 8; i++)
+      calTable.getPoint(i, raw[i], value[i]);
+    calPoly.fit(raw, value, 8, 3);
+  }
+  scaleSim.setCalCurve(&calPoly);
+
+  t = micros();
+  for (uint16_t i = 0; i < LOOPS; i++)
+    q = scaleSim.getCalibratedInt();
+  report("getCalibratedInt() CalPoly", micros() - t, LOOPS);
+  scaleSim.setCalCurve(nullptr);
+
+  // filters
+  benchFilter("MD_HX711_FilterAvg(16)", filterAvg);
+  benchFilter("MD_HX711_FilterMedian(5)", filterMedian);
+  benchFilter("MD_HX711_FilterEMA(3)", filterEMA);
+  filterBiquad.setLowPass(2.0, 80.0);
+  benchFilter("MD_HX711_FilterBiquad", filterBiquad);
+  benchFilter("MD_HX711_FilterAdaptive", filterAdaptive);
+  benchFilter("MD_HX711_FilterNotch", filterNotch);
+  benchFilter("MD_HX711_FilterKalman", filterKalman);
+  benchFilter("MD_HX711_FilterDecimate(16)", filterDecimate);
+
+  // tare, including waiting for data
+  t = micros();
+  scaleSim.autoZeroTare();
+  Serial.print("autoZeroTare()\t");
+  Serial.print((micros() - t) / 1000);
+  Serial.println(" ms");
+}
+
+void setup(void)
+{
+  Serial.begin(57600);
+  Serial.println("[MD_HX711 Benchmark]");
+
+  benchProtocol();
+  benchSimulated();
+}
+
+void loop(void) {}
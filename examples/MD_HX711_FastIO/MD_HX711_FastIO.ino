@@ -0,0 +1,40 @@
+// Use of the compile-time pin template variant of the library
+//
+// - Pins are specified as template parameters so that the HX711 is
+//   accessed through direct port I/O.
+// - Read default Channel A and B
+// - Display the raw data and read time to serial monitor
+//
+
+#include <MD_HX711.h>
+
+// Define pin connections to HX711 module
+const uint8_t PIN_DAT = 2;
+const uint8_t PIN_CLK = 4;
+
+MD_HX711T<PIN_CLK, PIN_DAT> scale;
+
+void setup(void)
+{
+  Serial.begin(57600);
+  Serial.println("[MD_HX711 FastIO]");
+
+  scale.begin();
+  scale.enableChannelB();
+}
+
+void loop(void)
+{
+  if (scale.isReady())
+  {
+    uint32_t timeStart = micros();
+    MD_HX711::channel_t ch = scale.read();
+    uint32_t timeRead = micros() - timeStart;
+
+    Serial.print(ch == MD_HX711::CH_A ? "A: " : "B: ");
+    Serial.print(scale.getRaw(ch));
+    Serial.print("\t(");
+    Serial.print(timeRead);
+    Serial.println("us)");
+  }
+}
@@ -30,6 +30,19 @@ const uint8_t PIN_SCALE = 5;
 
 MD_UISwitch_Digital swScale(PIN_SCALE);
 
+void newSample(MD_HX711Base &dev, const MD_HX711::sample_t &s)
+// Called from dev.service() when new data is received
+{
+  Serial.print(dev.getReadCount());
+  Serial.print(s.ch == MD_HX711::CH_A ? "\tA" : "\tB");
+  Serial.print(" r ");
+  Serial.print(s.raw);
+  Serial.print("\tt ");
+  Serial.print(dev.getTared(s.ch));
+  Serial.print("\tc ");
+  Serial.println(dev.getCalibrated(s.ch), 2);
+}
+
 void setup(void)
 {
   Serial.begin(57600);
@@ -38,6 +51,7 @@ void setup(void)
   swScale.begin();    // switch initilization
 
   scale.begin();      // scale initialization
+  scale.setCallback(newSample);
 #if ENABLE_CH_B
   scale.enableChannelB();
 #endif
@@ -51,28 +65,8 @@ void setup(void)
 
 void loop(void)
 {
-  static uint32_t lastRead = 0;
-
-#if ENABLE_IRQ
-  if (lastRead != scale.getReadCount())
-#else
-  if (scale.isReady())
-#endif
-  {
-    // display weight
-    MD_HX711::channel_t ch = scale.read();
-
-    lastRead = scale.getReadCount();
-
-    Serial.print(lastRead);
-    Serial.print(ch == MD_HX711::CH_A ? "\tA" : "\tB");
-    Serial.print(" r ");
-    Serial.print(scale.getRaw(ch));
-    Serial.print("\tt ");
-    Serial.print(scale.getTared(ch));
-    Serial.print("\tc ");
-    Serial.println(scale.getCalibrated(ch), 2);
-  }
+  // read the data (polled mode) and display any new data
+  scale.service();
 
   // process switch
   switch (swScale.read())
@@ -29,6 +29,7 @@
 #include <hd44780ioClass/hd44780_I2Cexp.h>
 
 #include <MD_HX711.h>
+#include <MD_HX711_Filter.h>
 #include <MD_UISwitch.h>
 
 // Set to 0 for polled mode, 1 for interrupt mode.
@@ -58,6 +59,7 @@ const uint8_t PIN_DAT = 2;
 const uint8_t PIN_CLK = 4;
 
 MD_HX711 scale(PIN_CLK, PIN_DAT);
+MD_HX711_FilterBiquad damping;    // dampen the fluctuations in readings
 
 // -- SWITCHES
 // Define pin connections for switches
@@ -124,22 +126,6 @@ private:
 
 cConfig config;
 
-float dampedWeight(float newReading)
-// Dampen the fluctuations in readings value and make any small negative values 0.0
-{
-  const float PORTION = 0.80;
-  static float lastReading = 0.0;
-
-  // dampen
-  lastReading += PORTION * (newReading - lastReading);
-
-  // kill small negative values
-  if (lastReading < 0.0 && lastReading > -0.1)
-    lastReading = 0.0;
-
-  return(lastReading);
-}
-
 void setup(void)
 {
 #if USE_DEBUG
@@ -174,6 +160,11 @@ void setup(void)
   scale.begin();
   scale.setZeroTare(config.tareValue);
   scale.setCalibration(config.calibValue, CALIBRATE_WEIGHT);
+  // first order damping, y += 0.8 * (x - y), as y = 0.8 * x + 0.2 * y1
+  const int32_t ONE = 1L << MD_HX711_FilterBiquad::COEFF_BITS;
+
+  damping.setCoeff(ONE - ONE / 5, 0, 0, -(ONE / 5), 0);
+  scale.setFilter(&damping);
 #if USE_INTERRUPT_MODE
   scale.enableInterruptMode();
 #endif
@@ -193,8 +184,14 @@ void loop(void)
   {
     scale.read();
 #endif
+    float weight = scale.getFilteredInt(MD_HX711::CH_A, 100) / 100.0;
+
+    // kill small negative values
+    if (weight < 0.0 && weight > -0.1)
+      weight = 0.0;
+
     lcd.setCursor(0, 0);
-    lcd.print(dampedWeight(scale.getCalibrated()), 1);
+    lcd.print(weight, 1);
     lcd.print("      ");  // clear following space of leftovers
     DEBUG("\nRaw value: ", scale.getRaw());
   }
@@ -1,4 +1,6 @@
 ﻿#include <MD_HX711.h>
+#include <MD_HX711_Cal.h>
+#include <MD_HX711_Filter.h>
 /**
 \page pageControl Hardware Control
 ## Sampling Rate
@@ -57,6 +59,31 @@ Clock Pulses | Input Channel | Gain
 
 Fewer than 25 and more than 27 clock pulses in one communication cycle will 
 cause a serial communication error requiring a HX711 reset.
+____
+
+## Interrupt Masking During Reads
+
+The only timing constraint on the processor during a read cycle is that CLK 
+must not stay HIGH for more than 60us, otherwise the HX711 powers down and 
+the read is corrupted. There is no maximum time for CLK LOW.
+
+By default the library disables interrupts for the whole read cycle. The 
+interrupts disabled time is then approximately
+
+    (24 + extras) * (2 * tWrite + tRead + 2us)
+
+where tWrite and tRead are the times for the processor to set the CLK 
+output and sample the DAT input. For digitalWrite()/digitalRead() on a 16MHz
+AVR (approximately 4us each) this is 350us to 380us, and for MD_HX711T 
+direct port I/O it is about 60us to 65us.
+
+When enableShortIRQMask() is used, interrupts are only disabled for each 
+CLK HIGH phase (from CLK going HIGH to CLK going LOW), approximately
+
+    tWrite + 1us + tRead + tWrite
+
+or about 13us with digitalWrite()/digitalRead() and less than 2us with 
+direct port I/O on a 16MHz AVR. Interrupts are serviced while CLK is LOW.
 
 \page pageLibrary Using the Library
 The library supports a polled and an interrupt driven approach to obtaining 
@@ -69,6 +96,19 @@ In all modes, the last received data is buffered in the library and retrieved
 using the getRaw(), getTared() and getCalibrated() methods, depending on what 
 data is needed by the application.
 
+Calibrated data is also available as integers, without floating point 
+arithmetic. getCalibratedInt() returns the value multiplied by a unit scale 
+(eg, grams calibration with scale 1000 gives milligrams) and getCalibratedFixed()
+returns the value in Q16.16 fixed point format. Samples removed from the sample 
+buffer are converted in the same way using calibrateBatch(). If the calibration
+is set using setCalibrationInt(), no floating point library code is needed.
+
+In interrupt mode new data may arrive while the application is reading the 
+previous data. The library uses a sequence counter to detect this and repeats
+the read, so multi-byte values are never returned with a mix of old and new 
+bytes. getSnapshot() returns the raw value, read count and timestamp for a 
+channel as a consistent set.
+
 ##Polled Mode
 This is the default operating mode for the library.
 
@@ -89,8 +129,319 @@ the HX711 based on an interrupt generated by the device DAT signal going low.
 The application can monitor the getReadCount() method to determine when
 new data has been received.
 
+## Sample Buffer
+By default only the last sample received for each channel is kept by the 
+library. If the application does not retrieve a sample before the next one 
+is received (eg, during a slow loop() iteration in interrupt mode), the 
+older sample is lost.
+
+An application supplied sample buffer can be nominated using setBuffer().
+Every sample received is then also queued in the buffer, with the number
+waiting given by available(). Samples are retrieved, oldest first, using 
+pop() or popBatch(). The buffer is safe to use between the interrupt handler
+and the application without disabling interrupts. Samples received when the 
+buffer is full are counted by getOverflowCount().
+
+    MD_HX711::sample_t buffer[16];
+
+    scale.setBuffer(buffer, 16);
+
+## Timestamps
+Each sample is timestamped at the time the HX711 signals that data is ready
+(DAT goes low), before the data is clocked out. The timestamp for the latest
+sample on each channel is returned by getTimestamp() and buffered samples 
+carry their own timestamp.
+
+The default time source is micros(). A different time source (eg, a 
+hardware timer counter) can be nominated using setTimeSource().
+
+## New Data Callback
+Rather than monitoring getReadCount() for new data, the application can 
+register a callback function using setCallback(). The callback is passed the
+device and the new sample (raw data, channel and timestamp).
+
+A deferred callback is invoked from service(), which should be called each 
+time through loop(). In polled mode service() also reads the HX711 when the 
+data is ready. If a sample buffer is set, the callback is invoked for every 
+buffered sample, otherwise for the latest sample only.
+
+An immediate callback is invoked as soon as the data is received, which in 
+interrupt mode is from the ISR. Immediate callbacks must be short and 
+interrupt safe.
+
+    void newSample(MD_HX711Base &dev, const MD_HX711::sample_t &s) { ... }
+
+    scale.setCallback(newSample);
+    ...
+    scale.service();    // in loop()
+
+## Missed Conversions
+The HX711 converts continuously at the rate set by the RATE pin. If the 
+data is not read (by the application in polled mode or the ISR in interrupt 
+mode) before the next conversion is completed, that data is lost. 
+
+The library compares the time between samples with the expected sample 
+period, set using setSamplePeriod(), to count the lost conversions for each 
+channel. The count is returned by getMissedCount(). The expected sample period 
+includes the settling time needed by the HX711 after a channel or gain change.
+
 For interrupt mode to work the I/O pin connected to the DAT signal must support 
 external interrupts (eg, for an Arduino Uno this would be pins 2 or 3).
+
+Up to HX711_MAX_INSTANCE (default 4) objects can be in interrupt mode at the 
+same time. A separate ISR is generated at compile time for each instance, so
+each ISR directly reaches its own object. The value of HX711_MAX_INSTANCE can
+be changed in the library header file for boards with more external interrupt 
+pins. For cores that support attachInterruptArg() (ESP32, ESP8266) the object 
+is passed directly to a common ISR and there is no limit on the number of 
+instances.
+
+## Asynchronous Mode
+In polled and interrupt modes the processor waits in short delays between 
+the CLK edges of a read cycle (50 to 54 edges). Asynchronous mode removes 
+these waits by advancing the read cycle by one CLK edge each time that 
+asyncTick() is called.
+
+The application calls asyncTick() periodically, usually from a hardware 
+timer interrupt. When idle, asyncTick() checks whether the HX711 has data 
+ready and starts a new read cycle. When the read cycle is completed, the data
+is saved and getReadCount() and any callback are updated as for other modes.
+
+As CLK is HIGH between alternate calls to asyncTick(), the calls must be 
+less than 60us apart (the HX711 power down time). A period between 10us and
+40us is recommended. 
+
+Asynchronous mode is turned on and off using enableAsyncMode().
+
+## Fast I/O
+The MD_HX711 object accesses the CLK and DAT pins using the standard 
+digitalWrite() and digitalRead() functions, with the pins nominated at run 
+time. This works on all architectures but each call involves a pin to port 
+lookup, repeated 50+ times for each HX711 conversion read.
+
+The MD_HX711T template variant takes the pins as template parameters, 
+allowing the port registers and bit masks to be resolved at compile time 
+(ATmega328/168 boards) or cached once at begin() (other AVR boards). All 
+other methods are the same as MD_HX711 and the same bit stream is clocked 
+to/from the HX711.
+
+    MD_HX711T<PIN_CLK, PIN_DAT> scale;
+
+## Bus Policies and Host Builds
+All access to the CLK and DAT signals is through a bus policy class given 
+as a template parameter to MD_HX711B, which implements the HX711 hardware 
+access for all the library objects. The bus methods are inlined into the 
+HX711 protocol code, so there is no extra overhead for each CLK edge. There 
+are no virtual functions, so no object carries a vtable pointer.
+
+The library provides the bus policies
+- MD_HX711_PinBus - the standard Arduino digitalWrite() and digitalRead() 
+  functions with pins set at run time. MD_HX711 is MD_HX711B<MD_HX711_PinBus>.
+- MD_HX711_FastBus - direct port I/O for pins known at compile time. 
+  MD_HX711T<PIN_CLK, PIN_DAT> is MD_HX711B<MD_HX711_FastBus<PIN_CLK, PIN_DAT>>.
+- MD_HX711_SimBus - connects the library to a simulated HX711 device model.
+
+The application can implement other bus policies (eg, for Linux GPIO), as 
+described for MD_HX711B.
+
+When the library is not compiled by the Arduino toolchain (ARDUINO is not 
+defined) MD_HX711_Host.h replaces Arduino.h, providing the functions used by
+the library with simulated time. This allows the library to be built and run
+on a host computer, usually with MD_HX711B and MD_HX711_SimBus.
+
+MD_HX711_Sim (MD_HX711_Sim.h) is a model of the HX711 device that can be 
+connected to MD_HX711_SimBus. It simulates the conversion timing, channel 
+and gain selection, power down and reset, and serial communication errors,
+allowing the library to be tested and benchmarked deterministically without
+hardware.
+
+    #include <MD_HX711.h>
+    #include <MD_HX711_Sim.h>
+
+    MD_HX711_Sim hx711(MD_HX711_Sim::PERIOD_80SPS);
+    MD_HX711B<MD_HX711_SimBus> scale((MD_HX711_SimBus(&hx711)));
+
+The host tests in the library test folder use these to check the library 
+operation. They are built and run using 'make' in that folder.
+
+## Performance
+The MD_HX711_Benchmark example measures the time taken by the library 
+acquisition and data processing methods, using real pins for the HX711 
+protocol and MD_HX711_Sim for methods that need data. No HX711 hardware is 
+needed. The example should be run to compare performance between releases.
+
+The host benchmark ('make bench' in the library test folder) times the same 
+methods on the host computer in ns per sample. It also counts the GPIO 
+operations and the CLK edges for each read cycle, measured against 
+MD_HX711_Sim, for each bus variant and channel/gain mode.
+
+The operations for each sample are
+
+Method           | GPIO operations                | Divisions | Float operations
+:----------------|:-------------------------------|:---------:|:-----------------
+HX711ReadData()  | 50-54 writes, 24 reads         | 0         | 0
+readNB()         | as HX711ReadData()             | 0 (1 if conversions missed) | 0
+getCalibrated()  | none                           | 0         | 1 int to float, 1 mul
+getCalibratedFixed() | none                       | 0         | 0 (3 64-bit multiply, 1 shift)
+getCalibratedInt() | none                         | 0         | 0 (3 64-bit multiply, 1 shift)
+MD_HX711_CalTable | none                         | 0         | 0 (log2(N) compares or 1 multiply to find the segment, 1 64-bit multiply)
+MD_HX711_CalPoly | none                          | 0         | 0 (1 64-bit multiply per order + 1)
+MD_HX711_FilterAvg | none                        | 0         | 0 (1 add, 1 subtract, 1 shift)
+MD_HX711_FilterMedian | none                     | 0         | 0 (up to 2N compares and N moves)
+MD_HX711_FilterEMA | none                        | 0         | 0 (2 shifts, 1 add, 1 subtract)
+MD_HX711_FilterBiquad | none                     | 0         | 0 (5 32x64-bit multiply)
+MD_HX711_FilterAdaptive | none                   | 0         | 0 (3 shifts, 4 compares, adds)
+MD_HX711_FilterNotch | none                      | 0 (2 64-bit when retuned) | 0 (as MD_HX711_FilterBiquad)
+MD_HX711_FilterKalman | none                     | 2 64-bit (1 more when the period changes) | 0 (about 15 64-bit multiply)
+MD_HX711_FilterDecimate | none                   | 0         | 0 (1 64-bit add, 2 64-bit shifts per block)
+autoZeroTare()   | 1 read cycle per sample per channel | 2 64-bit per channel at completion | 0
+
+## Tare
+The autoZeroTare() method sets the tare offset for both channels from the 
+mean of a number of samples (default TARE_SAMPLES) for each channel, blocking
+until this is done. If the library is in interrupt or asynchronous mode the 
+samples are received in that mode.
+
+autoZeroTareStart() starts the same tare operation without blocking. The 
+samples are processed as they are received, and isAutoZeroTareBusy() returns 
+false when the operation is completed. In polled mode the application must 
+continue to read data (eg, using service()) while the operation is in progress.
+
+The samples are accumulated with 64 bit integers, giving the exact mean. The 
+standard deviation of the samples is returned by getZeroTareStdDev() as an 
+indication of the noise level. If a noise limit is set using 
+setAutoZeroTareLimit(), samples further than the limit from the mean are 
+rejected and counted (getZeroTareRejected()).
+
+## Calibration Curves
+The linear calibration set using setCalibration() assumes that the load cell 
+output is proportional to the load. Where this is not accurate enough, a 
+calibration curve can be set for the channel using setCalCurve(). The curve
+converts the tared value to a calibrated integer value, in units chosen by the
+application, and is used by all the calibrated data methods.
+
+MD_HX711_CalTable is a piecewise linear calibration table built from a number
+of (tared value, calibrated value) points, usually measured with reference 
+weights. The slope of each segment is worked out once when the points are set,
+so each conversion is a segment search and one multiplication. If the points are
+evenly spaced the segment is found directly, otherwise a binary search is used. 
+The table can be saved to and loaded from a compact binary blob for storage 
+in EEPROM.
+
+    #include <MD_HX711_Cal.h>
+
+    MD_HX711_CalTable::point_t points[4];
+    MD_HX711_CalTable table(points, 4);
+
+    table.addPoint(0, 0);         // grams
+    table.addPoint(104000, 500);
+    table.addPoint(209000, 1000);
+    table.addPoint(316000, 1500);
+    scale.setCalCurve(&table);
+
+MD_HX711_CalPoly is a polynomial calibration curve of order 1 to 4, evaluated 
+in fixed point using Horner's method. The fit() method works out the polynomial 
+coefficients that best fit (least squares) a set of recorded calibration points.
+fit() uses floating point arithmetic, so it may be run on a host computer and 
+the resulting coefficients set in the application using set(), keeping the 
+floating point code out of the application.
+
+    MD_HX711_CalPoly poly;
+
+    poly.fit(rawPoints, valuePoints, NUM_POINTS, 3);
+    scale.setCalCurve(&poly);
+
+## Data Filters
+A data filter can be set for each channel using setFilter(). The filter is 
+applied to every sample as it is received, in any operating mode and whether
+or not the sample buffer is used, so the filter always sees the full data 
+stream. The filter output is kept separately from the raw data and is read 
+using getFiltered() (tared) or getFilteredInt() (calibrated). The filter 
+starts from the first sample received after it is set.
+
+Filters are called from the ISR in interrupt mode, so they use only integer
+arithmetic and do not allocate memory. Any storage they need is allocated by
+the application. Each filter object holds the state for one channel.
+
+A prefilter can also be set for each channel using setPreFilter(). The 
+prefilter is applied first and its output replaces the raw data, so it is 
+used for everything else (sample buffer, callback, tare, calibration and the 
+data filter). It is used to remove bad data, such as glitches from noise on 
+long cables.
+
+MD_HX711_FilterAvg is a moving average (boxcar) filter over a power of 2 
+number of samples, updated as a running sum.
+
+MD_HX711_FilterMedian is a 3, 5 or 7 sample median filter, normally used as 
+the prefilter. It removes single sample glitches completely and counts 
+samples that are further than a set limit from the median as rejected.
+
+MD_HX711_FilterEMA is an exponential moving average (first order IIR) filter 
+where the smoothing factor is a power of 2, so it needs only shifts and adds.
+
+MD_HX711_FilterBiquad is a second order IIR filter with fixed point 
+coefficients. setLowPass() sets it up as a Butterworth low pass filter for a 
+cutoff frequency and sample rate, which gives sharper separation of the signal 
+from noise than the moving average filters.
+
+MD_HX711_FilterAdaptive is an exponential moving average filter that changes 
+its smoothing with the data. A step change in the data (eg, a load placed on 
+the scale) switches to the fastest response, and while the data is stable the
+smoothing is increased up to a maximum. isSettled() shows when the maximum 
+smoothing has been reached, which can be used as a 'stable weight' indicator.
+
+At 80 SPS the HX711 does not reject 50Hz or 60Hz mains interference, which 
+appears in the data as an alias (30Hz and 20Hz at exactly 80 SPS). 
+MD_HX711_FilterNotch is a notch filter at the alias frequency. It measures the 
+actual sample period from the sample timestamps and retunes itself, using only 
+integer arithmetic, as the HX711 oscillator drifts. A moving average over 8 
+samples (100ms at 80 SPS) is a comb filter with zeros at all multiples of 10Hz, 
+and also removes both the 50Hz and 60Hz aliases at exactly 80 SPS.
+
+MD_HX711_FilterKalman is a two state Kalman filter that estimates both the 
+weight and its rate of change, read using getRate(). It is tuned by the 
+measurement noise (the sample noise with a stable load) and the process noise
+(how quickly the weight is expected to change), and uses the sample timestamps
+so it copes with uneven sample periods and missed conversions. The rate 
+estimate is useful for flow control (eg, filling or dosing), where the 
+predicted final weight can be worked out before the target is reached.
+
+MD_HX711_FilterDecimate sums blocks of a power of 2 number of samples and 
+outputs the mean of each block, trading sample rate for resolution. For random
+noise, a block of N samples gives log2(N)/2 extra bits, so a block of 64 
+samples at 10 SPS gives 3 extra bits every 6.4 seconds. getOutput() returns the
+block mean with the extra bits as fraction bits, with the number of fraction 
+bits, the block size and the timestamp of the block.
+
+    #include <MD_HX711_Filter.h>
+
+    int32_t avgBuf[8];
+    MD_HX711_FilterAvg avg(avgBuf, 8);
+
+    scale.setFilter(&avg);
+    ...
+    int32_t grams = scale.getFilteredInt();
+
+## Multiple Devices
+Where several HX711 devices are used (eg, multiple load cells), they can
+share a single CLK pin with a separate DAT pin for each device. The 
+MD_HX711Array object drives the shared CLK and samples all DAT lines on 
+each clock edge, so one read cycle obtains the data from every device at 
+the same time.
+
+The array is defined with the shared CLK pin and a list of DAT pins. It 
+keeps only the raw data and tare for each device, accessed by the device 
+index, as a full MD_HX711 object for each device would use much more RAM.
+Channel B and gain settings are made through the array and apply to all 
+devices. Filtering and calibration are left to the application, which will
+often combine the tared values before scaling (eg, a platform scale).
+
+    const uint8_t PIN_DAT[] = { PIN_DAT0, PIN_DAT1 };
+    MD_HX711Array<2> scales(PIN_CLK, PIN_DAT);
+    ...
+    scales.read();
+    int32_t total = scales.getTared(0) + scales.getTared(1);
+
 */
 
 #include <MD_HX711.h>
@@ -116,299 +467,610 @@ external interrupts (eg, for an Arduino Uno this would be pins 2 or 3).
 #define LIBPRINTB(s,v)
 #endif
 
- // Interrupt handling declarations required outside the class
- // Global Data
-static const uint8_t MAX_INSTANCE = 4;
-
-uint8_t MD_HX711::ISRUsed = 0;                 // allocation bit field for the globalISRx()
-MD_HX711* MD_HX711::myInstance[MAX_INSTANCE]; // callback instance handle for the ISR
-
-// ISR for each myISRId
-void MD_HX711::globalISR0(void) { MD_HX711::myInstance[0]->readNB(); }
-void MD_HX711::globalISR1(void) { MD_HX711::myInstance[1]->readNB(); }
-void MD_HX711::globalISR2(void) { MD_HX711::myInstance[2]->readNB(); }
-void MD_HX711::globalISR3(void) { MD_HX711::myInstance[3]->readNB(); }
+// Compiler memory barrier. The sample buffer is not volatile, so this stops 
+// the compiler moving the slot accesses across the buffer index updates.
+static inline void barrier(void) { asm volatile("" ::: "memory"); }
 
+#if !HX711_ISR_ARG
+MD_HX711Base* MD_HX711Base::myInstance[HX711_MAX_INSTANCE]; // callback instance handle for the ISR
+#endif
 
-void MD_HX711::begin(void)
+void MD_HX711Base::resetData(void)
+// set the library defaults
 {
-  LIBPRINTS("\nbegin()");
-  pinMode(_pinClk, OUTPUT);
-  pinMode(_pinDat, INPUT);
-
-  if (isInterruptMode())
-    disableISR();
+  LIBPRINTS("\nresetData()");
 
-  reset();
+  enableChannelB(false);
+  setGainA(GAIN_128);
+  enableShortIRQMask(false);
+  _nextReadA = true;
+  _readCounter = 0;
+  _seq = 0;
+  _lastCh = CH_A;
+  _cbCount = 0;
+  _lastTimeValid = false;
+  _lastExtras = 1;    // hardware reset default is A128
+  _readingCh = CH_A;
+  _readingExtras = 1;
+  _tareBusy = false;
+  _tareLimit = 0;
+  _settleNext = _settleThis = true;
+  _bufHead = _bufTail = 0;
+  _bufOverflow = 0;
+  for (uint8_t ch = 0; ch < NUM_CHAN; ch++)
+  {
+    _chanData[ch].raw = 0;
+    _chanData[ch].time = 0;
+    _chanData[ch].count = 0;
+    _chanData[ch].missed = 0;
+    _chanData[ch].tare = 0;
+    _chanData[ch].tareStdDev = 0;
+    _tareOp.count[ch] = 0;
+    _tareOp.rejected[ch] = 0;
+    _tareOp.run[ch] = 0;
+    _chanData[ch].calib = 0;
+    _chanData[ch].rangeM = 0;
+    _chanData[ch].rangeE = 0;
+    _chanData[ch].fixedValid = false;
+    _chanData[ch].floatValid = false;
+    _chanData[ch].cal = nullptr;
+    _chanData[ch].preFilter = nullptr;
+    _chanData[ch].filter = nullptr;
+    _chanData[ch].filtered = 0;
+  }
 }
 
-bool MD_HX711::enableInterruptMode(bool enable)
-// Control the interrupt processing on and off.
+void MD_HX711Base::autoZeroTareStart(uint8_t samples)
+// Set up for a tare operation processed by saveData()
 {
-  bool b = true;
+  LIBPRINT("\nautoZeroTareStart() ", samples);
 
-  if (enable)
-    b = enableISR();
-  else
-    disableISR();
+  if (samples == 0) samples = 1;
 
-  return(b);
+  noInterrupts();     // stop saveData() using the data while it changes
+  if (!_tareBusy) _tareOp.enableB = _enableB;    // remember this for later
+  _tareOp.samples = samples;
+  for (uint8_t ch = 0; ch < NUM_CHAN; ch++)
+  {
+    _tareOp.count[ch] = 0;
+    _tareOp.rejected[ch] = 0;
+    _tareOp.run[ch] = 0;
+  }
+  enableChannelB(true);   // set up so we measure both channels
+  _tareBusy = true;
+  interrupts();
 }
 
-bool MD_HX711::enableISR(void)
-// Enable the ISR on this pin instance
+void MD_HX711Base::tareData(channel_t ch, int32_t value)
+// Accumulate a sample for the tare operation and complete the 
+// operation when all channels have enough samples.
+// Called from saveData() and may be in the ISR.
 {
-  int8_t irq = digitalPinToInterrupt(_pinDat);
-
-  LIBPRINTS("\nenableISR()");
+  tareOp_t *pt = &_tareOp;
 
-  if (isInterruptMode()) return(false);
+  // skip a conversion made in a different mode (eg, before a gain change)
+  if (_readingExtras != (ch == CH_B ? 2 : (_mode == GAIN_128 ? 1 : 3)))
+    return;
 
-  // check if pin can be used for ISR
-  if (irq != NOT_AN_INTERRUPT)
+  if (pt->count[ch] < pt->samples)
   {
-    // assign ourselves a ISR ID ...
-    for (uint8_t i = 0; i < MAX_INSTANCE; i++)
+    int32_t d = value - pt->ref[ch];
+
+    if (pt->count[ch] != 0 && _tareLimit != 0)
     {
-      if (!(ISRUsed & _BV(i)))    // found a free ISR Id?
+      int32_t mean = pt->sum[ch] / pt->count[ch];
+
+      if (d - mean > _tareLimit || mean - d > _tareLimit)
       {
-        _myISRId = i;                // remember who this instance is
-        myInstance[_myISRId] = this; // record this instance
-        ISRUsed |= _BV(_myISRId);    // lock this in the allocations table
-        break;
+        // reject the sample, restart if it looks like the reference was the noise
+        pt->rejected[ch]++;
+        pt->run[ch]++;
+        if (pt->run[ch] <= pt->count[ch])
+          return;
+
+        // this sample is the new reference, the accepted samples are rejected
+        pt->rejected[ch] += pt->count[ch] - 1;
+        pt->count[ch] = 0;
       }
     }
-    // ... and attach corresponding ISR callback from the lookup table
-    {
-      static void((*ISRfunc[MAX_INSTANCE])(void)) =
-      {
-        globalISR0, globalISR1, globalISR2, globalISR3,
-      };
+    pt->run[ch] = 0;
 
-      if (_myISRId != UINT8_MAX)   // we found one
-      {
-        LIBPRINT(" assigned ", _myISRId);
-        attachInterrupt(irq, ISRfunc[_myISRId], LOW);
-        powerDown();    // reset the hardware
-        powerUp();
-      }
-      else
-        irq = NOT_AN_INTERRUPT;
+    if (pt->count[ch] == 0)   // first sample is the reference
+    {
+      pt->ref[ch] = value;
+      pt->sum[ch] = pt->sumSq[ch] = 0;
+      d = 0;
     }
+    pt->sum[ch] += d;
+    pt->sumSq[ch] += (int64_t)d * d;
+    pt->count[ch]++;
+  }
+
+  // check if all the channels are done
+  for (uint8_t i = 0; i < NUM_CHAN; i++)
+    if (pt->count[i] < pt->samples) return;
+
+  // if channel B is to be turned off, the conversion after this one must be A
+  if (!pt->enableB && !_nextReadA) return;
+
+  // work out the tare and standard deviation for each channel
+  for (uint8_t i = 0; i < NUM_CHAN; i++)
+  {
+    channelInfo_t *pc = &_chanData[i];
+
+    uint8_t n = pt->count[i];
+    int64_t mean = (pt->sum[i] + (pt->sum[i] < 0 ? -(n / 2) : (n / 2))) / n;
+
+    pc->tare = pt->ref[i] + (int32_t)mean;
+    pc->fixedValid = pc->floatValid = false;
+    pc->tareStdDev = (n < 2) ? 0 : isqrt((uint64_t)(pt->sumSq[i] - (pt->sum[i] / n) * pt->sum[i]) / (n - 1));
   }
 
-  return(irq != NOT_AN_INTERRUPT);
+  enableChannelB(pt->enableB);
+  _tareBusy = false;
 }
 
-void MD_HX711::disableISR(void)
-// Disable the ISR on this pin instance
-// Shuffle the instance table entries up to squish out empty slots
+uint32_t MD_HX711Base::isqrt(uint64_t v)
+// Integer square root, bit by bit method
 {
-  LIBPRINTS("\ndisableISR()");
+  uint64_t r = 0;
+  uint64_t b = (uint64_t)1 << 62;
 
-  if (isInterruptMode())
+  while (b > v) b >>= 2;
+  while (b != 0)
   {
-    LIBPRINTS(" stopping ISR");
+    if (v >= r + b)
+    {
+      v -= r + b;
+      r = (r >> 1) + b;
+    }
+    else
+      r >>= 1;
+    b >>= 2;
+  }
+
+  return((uint32_t)r);
+}
 
-    while (_inISR) { yield(); } ;   // wait for any current IRQ to stop
+void MD_HX711Base::setZeroTare(int32_t tare, channel_t ch)
+// Set the tare for a channel
+{
+  noInterrupts();     // stop saveData() changing the tare at the same time
+  _seq++;
+  _chanData[ch].tare = tare;
+  _chanData[ch].fixedValid = _chanData[ch].floatValid = false;
+  _seq++;
+  interrupts();
+}
 
-    noInterrupts();         // stop IRQs that may access this table while reorganizing
+void MD_HX711Base::setCalibration(int32_t value, float range, channel_t ch)
+// Save the calibration with the range as a fixed point mantissa and exponent.
+{
+  int e;
+  float m = frexp(range, &e);   // 0.5 <= |m| < 1
 
-    detachInterrupt(digitalPinToInterrupt(_pinDat));
-    ISRUsed &= ~_BV(_myISRId);   // free up the ISR slot for someone else
+  setRange(value, (int32_t)ldexp(m, 31), (m == 0.0) ? 0 : e - 31, ch);
+}
 
-    interrupts();     // IRQs can access again
+void MD_HX711Base::setCalibrationInt(int32_t value, int32_t range, channel_t ch)
+// Save the calibration with the range normalized to the same 
+// form as setCalibration(), using only integer arithmetic.
+{
+  int8_t e = 0;
+
+  if (range != 0)
+  {
+    while (range < 0x40000000L && range > -0x40000000L)
+    {
+      range *= 2;
+      e--;
+    }
   }
+  setRange(value, range, e, ch);
+}
 
-  // reset global indicators
-  _myISRId = UINT8_MAX;
-  _inISR = false;
+void MD_HX711Base::setRange(int32_t value, int32_t m, int8_t e, channel_t ch)
+// Save the calibration value and range m * 2^e
+{
+  _chanData[ch].calib = value;
+  _chanData[ch].rangeM = m;
+  _chanData[ch].rangeE = e;
+  _chanData[ch].fixedValid = _chanData[ch].floatValid = false;
 }
 
-void MD_HX711::reset(void)
-// set defaults and power cycle the hardware
+void MD_HX711Base::checkScale(channel_t ch)
+// Work out the fixed point scale factor range/(calib-tare) if the 
+// calibration or tare has changed. The ISR may change the tare 
+// while this is running, so clear the flag first and a new change 
+// will be picked up next time.
 {
-  LIBPRINTS("\nreset()");
-  powerDown();
-  powerUp();
+  channelInfo_t *pc = &_chanData[ch];
 
-  // set the library defaults
-  enableChannelB(false);
-  setGainA(GAIN_128);
-  disableISR();
-  _nextReadA = true;
-  _readCounter = 0;
-  for (uint8_t ch = 0; ch < NUM_CHAN; ch++)
+  if (pc->fixedValid) return;
+  pc->fixedValid = true;
+
+  int32_t diff = pc->calib - seqRead(pc->tare);
+
+  pc->mult = 0;
+  pc->shift = 0;
+  if (diff == 0 || pc->rangeM == 0) return;
+
+  // q = rangeM * 2^32 / diff, then reduced to 31 bits
+  int64_t q = ((int64_t)pc->rangeM * ((int64_t)1 << 32)) / diff;
+  int16_t n = 0;
+
+  while (q >= (int64_t)0x7fffffffL || q <= -(int64_t)0x7fffffffL)
   {
-    _chanData[ch].raw = 0;
-    _chanData[ch].tare = 0;
-    _chanData[ch].calib = 0;
-    _chanData[ch].range = 0.0;
+    q = (q + 1) >> 1;
+    n++;
   }
+  pc->mult = (int32_t)q;
+  pc->shift = 32 - n - pc->rangeE;
 }
 
-inline void MD_HX711::powerDown(void)
-// Set the CLK to low for at least 60us.
+int32_t MD_HX711Base::mulShift(int32_t x, int32_t mult, int16_t shift, uint32_t unit)
+// Return (x * mult * unit) >> shift, rounded to nearest and limited to the 
+// int32_t range. The magnitude of x * mult fits in 55 bits for 24 bit 
+// data, so the product with unit needs up to 87 bits. This is held as 
+// hi:lo, where lo is the lower 32 bits.
 {
-  LIBPRINTS("\npowerDown()");
-  digitalWrite(_pinClk, HIGH);
-  delayMicroseconds(64);   //  at least 60us HIGH
+  int64_t v = (int64_t)x * mult;
+  bool neg = (v < 0);
+  uint64_t u = neg ? -(uint64_t)v : (uint64_t)v;
+  uint64_t lo = (u & 0xffffffffUL) * unit;
+  uint64_t hi = (u >> 32) * unit + (lo >> 32);
+  uint64_t r;
+
+  lo &= 0xffffffffUL;
+
+  if (shift >= 96)
+    r = 0;
+  else if (shift >= 32)
+  {
+    hi += ((uint64_t)1 << (shift - 32)) >> 1;    // rounding, may be 0
+    if (shift == 32) hi += (lo >> 31);
+    r = (shift - 32 >= 64) ? 0 : hi >> (shift - 32);
+  }
+  else if (hi >= 0x80000000UL)
+    r = 0x7fffffffL;
+  else if (shift > 0)
+  {
+    r = (hi << (32 - shift)) | (lo >> shift);
+    r += (lo >> (shift - 1)) & 1;   // rounding
+  }
+  else if (hi != 0 || (lo != 0 && ((-shift > 31) || (lo >> (32 + shift)) != 0)))
+    r = 0x7fffffffL;
+  else
+    r = lo << -shift;
+
+  if (r > 0x7fffffffL) r = 0x7fffffffL;
+
+  return(neg ? -(int32_t)r : (int32_t)r);
 }
 
-inline void MD_HX711::powerUp(void)
-// set the CLK to high
+int32_t MD_HX711Base::getTared(channel_t ch)
+// Return the latest data adjusted for tare
 {
-  LIBPRINTS("\npowerUp()");
-  digitalWrite(_pinClk, LOW);
+  uint8_t seq;
+  int32_t value;
+
+  do
+  {
+    while ((seq = _seq) & 1) { }  // wait out an update in progress
+    value = _chanData[ch].raw - _chanData[ch].tare;
+  } while (seq != _seq);
+
+  return(value);
 }
 
-void MD_HX711::autoZeroTare(void)
+void MD_HX711Base::setFilter(MD_HX711_Filter *f, channel_t ch)
+// Set the filter, which starts with the next sample. The latest data 
+// is not applied as it is not a real sample before the first read.
 {
-  const uint8_t NUM_PASSES = 3;
+  noInterrupts();     // stop saveData() using the filter while it changes
+  if (f != nullptr) f->reset();
+  _chanData[ch].filtered = _chanData[ch].raw;
+  _chanData[ch].filter = f;
+  interrupts();
+}
 
-  LIBPRINTS("\nsetTare()");
+void MD_HX711Base::setPreFilter(MD_HX711_Filter *f, channel_t ch)
+// Set the prefilter, which starts with the next sample
+{
+  noInterrupts();     // stop saveData() using the filter while it changes
+  if (f != nullptr) f->reset();
+  _chanData[ch].preFilter = f;
+  interrupts();
+}
 
-  bool b = _enableB;      // remember this for later
-  bool wasIRQ = isInterruptMode();
+int32_t MD_HX711Base::getFiltered(channel_t ch)
+// Return the latest filter output adjusted for tare
+{
+  uint8_t seq;
+  int32_t value;
 
-  // set the right environment
-  if (wasIRQ) enableInterruptMode(false); // turn IRQ processing off
-  enableChannelB(true);   // set up so we measure both channels
+  if (_chanData[ch].filter == nullptr) return(getTared(ch));
 
-  // now take the average of NUM_PASSES readings for each channel
-  for (int8_t n = 0; n < NUM_PASSES; n++)
+  do
   {
-    for (int8_t i = 0; i < NUM_CHAN; i++)
-    {
-      channel_t ch = read();
-      if (n == 0) 
-        _chanData[ch].tare = _chanData[ch].raw;   // first time through just save the value
-      else 
-        _chanData[ch].tare = ((_chanData[ch].tare * (n - 1)) + _chanData[ch].raw) / n; // running average(ish)
-    }
-  }
+    while ((seq = _seq) & 1) { }  // wait out an update in progress
+    value = _chanData[ch].filtered - _chanData[ch].tare;
+  } while (seq != _seq);
+
+  return(value);
+}
 
-  // now reset the environment to previous state
-  enableChannelB(b);
-  if (wasIRQ) enableInterruptMode(true);
+int32_t MD_HX711Base::getFilteredInt(channel_t ch, uint32_t unitScale)
+// return filtered value adjusted for tare and calibration in application units
+{
+  checkScale(ch);
+  return(calibrateInt(ch, getFiltered(ch), 0, unitScale));
 }
 
-float MD_HX711::getCalibrated(channel_t ch)
+float MD_HX711Base::getCalibrated(channel_t ch)
 // retun value adjusted for tare and calibration
 {
-  float f;
-/*
-  LIBPRINT("\ngetCalbrated rng ", _chanData[ch].range);
-  LIBPRINT(", raw ", _chanData[ch].raw);
-  LIBPRINT(", cal ", _chanData[ch].calib);
-  LIBPRINT(", tare ", _chanData[ch].tare);
-*/
-  if (_chanData[ch].calib - _chanData[ch].tare == 0)
-    f = NAN;
-  else
-    f = _chanData[ch].range * (float(_chanData[ch].raw) - float(_chanData[ch].tare)) / (float(_chanData[ch].calib) - float(_chanData[ch].tare));
+  channelInfo_t *pc = &_chanData[ch];
+
+  if (pc->cal != nullptr)
+  {
+    int32_t v = pc->cal->calibrate(getTared(ch));
+
+    return(v == CALIB_INVALID ? NAN : float(v));
+  }
 
-  return(f);
+  if (!pc->floatValid)
+  {
+    pc->floatValid = true;
+    checkScale(ch);
+    pc->scale = (pc->mult == 0) ? NAN : ldexp(float(pc->mult), -pc->shift);
+  }
+
+  return(pc->scale * float(getTared(ch)));
 }
 
-MD_HX711::channel_t MD_HX711::read(void)
-// Blocking read. The method waits for the HX711 to tell us it has data.
-// If operating in interrupt mode it immediately returns.
+int32_t MD_HX711Base::calibrateInt(channel_t ch, int32_t tared, int8_t q, uint32_t unit)
+// Return the calibrated value for tared, multiplied by unit * 2^q. 
+// For linear calibration checkScale() must have been called.
 {
-  LIBPRINTS("\nread()");
+  channelInfo_t *pc = &_chanData[ch];
 
-  // check for interrupt mode
-  if (!isInterruptMode())
+  if (pc->cal != nullptr)
   {
-    // blocking wait to make sure we have data to read
-    while (!isReady()) { yield(); }
+    int32_t v = pc->cal->calibrate(tared);
 
-    // do the actual non-blocking read
-    readNB();
+    if (v == CALIB_INVALID) return(v);
+    return(mulShift(v, 1, -q, unit));
   }
 
-  // work out what channel we have just read to inform return code
-  return(_enableB && _nextReadA ? CH_B : CH_A);
+  if (pc->mult == 0) return(CALIB_INVALID);
+
+  return(mulShift(tared, pc->mult, pc->shift - q, unit));
 }
 
-void MD_HX711::readNB(void)
-// NON-Blocking read the data from the HX711 in an IRQ safe manner.
-// Note: Only print debug if not IRQ processing 
+int32_t MD_HX711Base::getCalibratedFixed(channel_t ch)
+// return value adjusted for tare and calibration in Q16.16 format
 {
-  uint8_t extras = 0;
-  int32_t value;
+  checkScale(ch);
+  return(calibrateInt(ch, getTared(ch), 16, 1));
+}
 
-  _inISR = true;
+int32_t MD_HX711Base::getCalibratedInt(channel_t ch, uint32_t unitScale)
+// return value adjusted for tare and calibration in application units
+{
+  checkScale(ch);
+  return(calibrateInt(ch, getTared(ch), 0, unitScale));
+}
+
+void MD_HX711Base::calibrateBatch(const sample_t *s, int32_t *value, uint8_t count, uint32_t unitScale)
+// convert buffered raw samples to values adjusted for tare and calibration
+{
+  int32_t tare[NUM_CHAN];
+
+  for (uint8_t ch = 0; ch < NUM_CHAN; ch++)
+  {
+    checkScale((channel_t)ch);
+    tare[ch] = seqRead(_chanData[ch].tare);
+  }
 
-  //if (isInterruptMode()) LIBPRINTS("\nreadNB()");
+  for (uint8_t i = 0; i < count; i++)
+    value[i] = calibrateInt(s[i].ch, s[i].raw - tare[s[i].ch], 0, unitScale);
+}
 
-  // set the next read channel
-  if (_enableB) _nextReadA = !_nextReadA;
+uint8_t MD_HX711Base::nextReadMode(void)
+// Set the next read channel and work out how many extra
+// clock cycles to send when reading data
+{
+  uint8_t extras;
 
-  // now work out how many extra clock cycles send when reading data
-  if (!_nextReadA)            extras = 2; // Channel B gain 32
-  else if (_mode == GAIN_128) extras = 1; // Channel A gain 128
-  else                        extras = 3; // Channel B gain 64
+  if (_enableB) 
+    _nextReadA = !_nextReadA;
+  else
+    _nextReadA = true;    // B may have been selected before it was disabled
 
-  //if (isInterruptMode()) LIBPRINT(" extras=", extras);
+  extras = modeExtras(_nextReadA, _mode);
 
-  // do the read
-  noInterrupts();
-  value = HX711ReadData(extras);
-  interrupts();
+  // the conversion being read was set up by the last read
+  _readingExtras = _lastExtras;
+  _readingCh = (_lastExtras == 2) ? CH_B : CH_A;
 
-  //if (isInterruptMode()) LIBPRINTX(" raw_value=", value);
+  // a change of mode means the next conversion needs to settle
+  _settleThis = _settleNext;
+  _settleNext = (extras != _lastExtras);
+  _lastExtras = extras;
 
+  return(extras);
+}
+
+void MD_HX711Base::saveData(int32_t value, uint32_t time)
+// Save the data just read from the HX711 to the channel it came from
+{
   // sign extend the returned data
   if (value & 0x800000) value |= 0xff000000;
 
   //if (isInterruptMode()) LIBPRINTX(" ext_value=", value);
 
-  // save the data to the right index value
-  channel_t ch = (_enableB && _nextReadA) ? CH_B : CH_A;
+  // save the data to the channel it was converted from, as _enableB 
+  // may have changed since the read started (eg, in async mode)
+  channel_t ch = _readingCh;
+  if (_chanData[ch].preFilter != nullptr)
+    value = _chanData[ch].preFilter->apply(value, time);
+
+  _seq++;       // odd - update in progress
   _chanData[ch].raw = value;
+  _chanData[ch].time = time;
+  _lastCh = ch;
+  if (_tareBusy) tareData(ch, value);
+  if (_chanData[ch].filter != nullptr)
+    _chanData[ch].filtered = _chanData[ch].filter->apply(value, time);
+
+  // check if any conversions were missed since the last one
+  if (_lastTimeValid && _period != 0)
+  {
+    uint32_t expect = _settleThis ? 4 * _period : _period;
+    uint32_t dt = time - _lastTime;
+
+    if (dt > expect + (_period / 2))
+      _chanData[ch].missed += (dt - expect + (_period / 2)) / _period;
+  }
+  _lastTime = time;
+  _lastTimeValid = true;
+
+  // queue the sample if there is space in the buffer
+  if (_buf != nullptr)
+  {
+    uint8_t h = _bufHead;
+
+    if ((uint8_t)(h - _bufTail) <= _bufMask)
+    {
+      _buf[h & _bufMask].raw = value;
+      _buf[h & _bufMask].ch = ch;
+      _buf[h & _bufMask].time = time;
+      barrier();
+      _bufHead = h + 1;   // publish the sample only after it is written
+    }
+    else
+      _bufOverflow++;
+  }
 
-  // increment the counter
+  // increment the counters
   _readCounter++;
+  _chanData[ch].count = _readCounter;
+  _seq++;       // even - update completed
+
+  // tell the application if it wants to know now
+  if (_cb != nullptr && _cbImmediate)
+  {
+    sample_t s = { value, ch, time };
+
+    _cb(*this, s);
+  }
+}
 
-  _inISR = false;
+void MD_HX711Base::setCallback(cbSample_t cb, bool immediate)
+// Set the new data callback
+{
+  noInterrupts();     // stop saveData() using the callback while it changes
+  _cb = cb;
+  _cbImmediate = immediate;
+  _cbCount = _readCounter;
+  interrupts();
 }
 
-int32_t MD_HX711::HX711ReadData(uint8_t mode)
-// read data and set the mode for next read depending on what 
-// options are selected in the library
+void MD_HX711Base::serviceCallback(void)
+// Pass new data to the deferred callback
 {
-  // local variables are faster for pins
-  uint8_t clk = _pinClk;
-  uint8_t data = _pinDat;
-
-  // data read controls
-  int32_t value = 0;
-  uint32_t mask = 0x800000L;
-    
-  do   // Read data bits from the HX711
+  if (_cb == nullptr || _cbImmediate)
+    return;
+
+  if (_buf != nullptr)
   {
-    digitalWrite(clk, HIGH);
+    // pass on everything in the buffer
+    sample_t s;
 
-    delayMicroseconds(1);   // T2 typ 1us
+    while (pop(s))
+      _cb(*this, s);
+  }
+  else
+  {
+    // pass on the latest data if there is new data
+    sample_t s;
+    uint32_t count;
+    uint8_t seq;
 
-    if (digitalRead(data) == HIGH) value |= mask;
-    digitalWrite(clk, LOW); 
+    do
+    {
+      while ((seq = _seq) & 1) { }  // wait out an update in progress
+      count = _readCounter;
+      s.ch = _lastCh;
+      s.raw = _chanData[s.ch].raw;
+      s.time = _chanData[s.ch].time;
+    } while (seq != _seq);
+
+    if (count != _cbCount)
+    {
+      _cbCount = count;
+      _cb(*this, s);
+    }
+  }
+}
 
-    delayMicroseconds(1);  // T3 typ 1us
-    mask >>= 1;
-  } while (mask > 0);
+void MD_HX711Base::getSnapshot(snapshot_t &s, channel_t ch)
+// Copy the data for a channel, repeating the copy if saveData() 
+// changed it while it was being copied.
+{
+  uint8_t seq;
 
-  // Set the mode for the next read (just keep clocking)
   do
   {
-    digitalWrite(clk, HIGH);
-    delayMicroseconds(1);
-    digitalWrite(clk, LOW);
-    delayMicroseconds(1);
-    mode--;
-  } while (mode > 0);
+    while ((seq = _seq) & 1) { }  // wait out an update in progress
+    s.raw = _chanData[ch].raw;
+    s.ch = ch;
+    s.count = _chanData[ch].count;
+    s.time = _chanData[ch].time;
+  } while (seq != _seq);
+}
 
-  return(value);
+bool MD_HX711Base::setBuffer(sample_t *buf, uint8_t size)
+// Set the buffer storage. Size must be a power of 2.
+{
+  LIBPRINT("\nsetBuffer() size ", size);
+
+  if (buf != nullptr && (size == 0 || size > 128 || (size & (size - 1)) != 0))
+    return(false);
+
+  noInterrupts();     // stop saveData() using the buffer while it changes
+  _buf = buf;
+  _bufMask = (buf == nullptr) ? 0 : size - 1;
+  _bufHead = _bufTail = 0;
+  interrupts();
+
+  return(true);
 }
 
+bool MD_HX711Base::pop(sample_t &s)
+// Remove the oldest sample from the buffer
+{
+  uint8_t t = _bufTail;
+
+  if (t == _bufHead)
+    return(false);
+
+  barrier();
+  s = _buf[t & _bufMask];
+  barrier();
+  _bufTail = t + 1;   // release the slot only after it is read
+
+  return(true);
+}
+
+uint8_t MD_HX711Base::popBatch(sample_t *s, uint8_t max)
+// Remove up to max samples from the buffer
+{
+  uint8_t n = 0;
+
+  while (n < max && pop(s[n]))
+    n++;
+
+  return(n);
+}
@@ -8,8 +8,16 @@ A library to manage the configuration and reading of data of a HX711
 This library implements a software interface to the HX711 hardware that enables:
 - Channel A gain control selection. 
 - Access to both ADC Channels A and B.
-- Application can work in polled or interrupt data collection modes.
+- Application can work in polled, interrupt or timer driven asynchronous 
+  data collection modes.
 - Data retrieved as raw, tared or calibrated values.
+- Linear, multi-point table or polynomial calibration for non-linear load cells.
+- Optional sample buffer so no data is lost in interrupt mode.
+- Optional per channel integer data filters.
+- Each sample is timestamped when the data is ready.
+- Callback notification of new data.
+- Compile-time pin template variant (MD_HX711T) using direct port I/O.
+- Multiple devices read in parallel on a shared CLK (MD_HX711Array).
 
 \image{inline} html HX711_Module_PCB.jpg "HX711 Module"
 
@@ -126,21 +134,89 @@ License along with this library; if not, write to the Free Software
 Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
 
 \page pageRevisionHistory Revision History
+Oct 2026 ver 1.1.0
+- Added MD_HX711T compile-time pin template with direct port I/O.
+- Added MD_HX711Array for parallel read of devices sharing a CLK pin.
+- Added sample buffer to queue data received in interrupt mode.
+- Added sample timestamps with a selectable time source.
+- Number of interrupt mode instances set by HX711_MAX_INSTANCE.
+- Data is read without tearing when updated by the ISR. Added getSnapshot().
+- Added missed conversion counts for each channel.
+- Added new sample callback and service() method.
+- Added option to only disable interrupts while CLK is high during reads.
+- Added asynchronous mode, advancing a read by one CLK edge per timer tick.
+- Added MD_HX711B bus policy template, MD_HX711_SimBus and host build support.
+- Added MD_HX711_Sim HX711 device simulator.
+- Added MD_HX711_Benchmark example.
+- Added non-blocking autoZeroTareStart(), configurable samples, noise rejection
+  and standard deviation. autoZeroTare() no longer leaves interrupt mode.
+- Calibration scale factor is calculated once, not for every sample. Added
+  getCalibratedFixed() for Q16.16 calibrated data.
+- Added getCalibratedInt(), calibrateBatch() and setCalibrationInt() for 
+  integer calibrated data in application units.
+- Added calibration curves using setCalCurve() and MD_HX711_CalTable piecewise
+  linear calibration table.
+- Added MD_HX711_CalPoly polynomial calibration curve with least squares fit.
+- Added per channel data filters using setFilter() and MD_HX711_FilterAvg 
+  moving average filter.
+- Added per channel prefilter using setPreFilter() and MD_HX711_FilterMedian
+  median filter for glitch rejection.
+- Added MD_HX711_FilterEMA exponential moving average and MD_HX711_FilterBiquad
+  second order IIR (Butterworth low pass) filters.
+- Added MD_HX711_FilterAdaptive adaptive smoothing filter.
+- Added MD_HX711_FilterNotch mains frequency notch filter for 80 SPS.
+- Added MD_HX711_FilterKalman fixed point Kalman filter for weight and rate.
+- Added MD_HX711_FilterDecimate decimating filter for extra resolution at a 
+  lower output rate.
+
 Jul 2023 ver 1.0.0
 - Initial release
 */
 
+#if defined(ARDUINO)
 #include <Arduino.h>
+#else
+#include "MD_HX711_Host.h"
+#endif
+
+/**
+ * Maximum number of MD_HX711 objects that can be in interrupt mode at the same 
+ * time. An ISR trampoline is generated for each instance. This is not used for 
+ * architectures where the core supports attachInterruptArg() (see HX711_ISR_ARG).
+ * 
+ * The instance table is in the library code file, so this value must only be 
+ * changed here and not defined in the application before including this file.
+ */
+#define HX711_MAX_INSTANCE 4
+
+#if defined(ESP32) || defined(ESP8266)
+#define HX711_ISR_ARG 1   ///< 1 if the core supports attachInterruptArg(), 0 otherwise
+#else
+#define HX711_ISR_ARG 0   ///< 1 if the core supports attachInterruptArg(), 0 otherwise
+#endif
 
 /**
  * \file
  * \brief Main header file and class definition for the MD_HX711 library.
  */
 
+template <uint8_t N> class MD_HX711Array;
+template <class BUS> class MD_HX711B;
+class MD_HX711_Cal;
+class MD_HX711_Filter;
+
 /**
- * Core object for the MD_HX711 library
+ * Common base class for the MD_HX711 objects.
+ *
+ * This class holds the library data and implements everything that does not
+ * depend on how the HX711 CLK and DAT signals are accessed (tare, calibration,
+ * filters, sample buffer and callbacks). The hardware access is implemented
+ * by the MD_HX711B template using a bus policy fixed at compile time, so
+ * there are no virtual functions.
+ *
+ * Applications create MD_HX711, MD_HX711T or MD_HX711B objects.
  */
-class MD_HX711
+class MD_HX711Base
 {
 public:
  /**
@@ -166,60 +242,65 @@ public:
     GAIN_64,  ///< Channel A gain 64
   };
 
-  //--------------------------------------------------------------
-  /** \name Class constructor and destructor.
-   * @{
-   */
   /**
-   * Class Constructor
+   * Sample data type.
    *
-   * Instantiate a new instance of the class.
-   *
-   * The main function for the core object is to set the internal
-   * shared variables to default or passed values.
+   * This structure holds one sample received from the HX711 and is the 
+   * type of the elements in the sample buffer.
    *
-   * \param pinClk pin used for SCK/CLK signal.
-   * \param pinDat pin used for DAT/SD signal.
+   * \sa setBuffer()
    */
-    MD_HX711(uint8_t pinClk, uint8_t pinDat) :
-        _pinClk(pinClk), _pinDat(pinDat), _myISRId(UINT8_MAX)
-    {}
-  
-   /**
-    * Class Destructor.
-    *
-    * Release any allocated memory and clean up anything else as required.
-    */
-     ~MD_HX711() { disableISR(); }
-
-     /** @} */
+  typedef struct
+  {
+    int32_t raw;    ///< raw data value
+    channel_t ch;   ///< channel the data was read from
+    uint32_t time;  ///< time source value when the data was ready
+  } sample_t;
 
-  //--------------------------------------------------------------
-  /** \name Methods for hardware control.
-   * @{
+  /**
+   * Time source function type.
+   *
+   * This is the type of the function used to timestamp each sample.
+   * The default time source is micros().
+   *
+   * \sa setTimeSource()
    */
+  typedef unsigned long (*timeSource_t)(void);
+
   /**
-   * Initialize the object.
+   * New sample callback function type.
    *
-   * Initialize the object data. This needs to be called during setup()
-   * to set and initialize items that cannot be done during object creation.
-   * 
-   * A reset() is performed as part of this method.
-   * 
-   * \sa reset()
+   * This is the type of the function called when new data is received.
+   * The callback is passed the device object and the new sample.
+   *
+   * \sa setCallback(), service()
    */
-    void begin(void);
+  typedef void (*cbSample_t)(MD_HX711Base &dev, const sample_t &s);
+
+  static const int32_t CALIB_INVALID = (-0x7fffffffL - 1); ///< Returned by integer calibrated methods when not calibrated
+  static const uint8_t TARE_SAMPLES = 3;        ///< Default number of samples for autoZeroTare()
+  static const uint32_t PERIOD_10SPS = 100000;  ///< Sample period in us for 10 SPS RATE setting
+  static const uint32_t PERIOD_80SPS = 12500;   ///< Sample period in us for 80 SPS RATE setting
 
   /**
-   * Reset the HX711 hardware and library defaults.
+   * Data snapshot type.
    *
-   * The HX711 Hardware is reset according to the protocol described in the data sheet
-   * \ref pageControl. The library internal values and modes are also reset to default.
+   * This structure holds a consistent copy of the latest data for a channel.
    *
-   * \sa \ref pageControl
+   * \sa getSnapshot()
    */
-    void reset(void);
+  typedef struct
+  {
+    int32_t raw;    ///< raw data value
+    channel_t ch;   ///< channel the data was read from
+    uint32_t count; ///< read count (getReadCount()) when the data was received
+    uint32_t time;  ///< time source value when the data was ready
+  } snapshot_t;
 
+  //--------------------------------------------------------------
+  /** \name Methods for hardware control.
+   * @{
+   */
   /**
    * Enable Channel B read cycle.
    *
@@ -249,6 +330,24 @@ public:
     */
   inline void setGainA(mode_t mode) { _mode = mode; }
 
+  /**
+    * Limit the time interrupts are disabled during a read.
+    *
+    * By default interrupts are disabled for the whole of the HX711 read cycle
+    * (25 to 27 clock pulses), which may cause other interrupt handlers to miss 
+    * events. When this option is enabled, interrupts are only disabled while 
+    * CLK is high for each clock pulse, as this is the only part of the cycle 
+    * that is time critical (CLK high for more than 60us powers down the HX711).
+    * 
+    * The total read time increases by the time spent servicing any interrupts
+    * that occur during the read.
+    *
+    * \sa \ref pageControl
+    *
+    * \param ena set true to enable, false to disable.
+    */
+  inline void enableShortIRQMask(bool ena = true) { _shortMask = ena; }
+
 
     /** @} */
 
@@ -256,48 +355,70 @@ public:
   /** \name Methods for Data management.
    * @{
    */
+  /**
+    * Start a non-blocking tare operation for all channels.
+    *
+    * Start an autoZeroTare() operation that does not block. The samples are 
+    * processed as they are received from the HX711 in any mode. In polled mode 
+    * the application must keep reading the data (read() or service()). Channel B
+    * is enabled for the duration of the tare operation.
+    * 
+    * The tare offset is the mean of the accepted samples, accumulated using 
+    * integer arithmetic. If a noise limit is set, samples further than the limit 
+    * from the current mean are rejected. Samples converted before a change of
+    * channel A gain took effect are skipped.
+    * 
+    * Use isAutoZeroTareBusy() to check when the operation has completed.
+    *
+    * \sa autoZeroTare(), isAutoZeroTareBusy(), setAutoZeroTareLimit()
+    *
+    * \param samples the number of samples to average for each channel. Default TARE_SAMPLES.
+    */
+  void autoZeroTareStart(uint8_t samples = TARE_SAMPLES);
 
-   /**
-    * Return status of data ready at HX711
+  /**
+    * Check if a tare operation is in progress.
     *
-    * Return boolean status of whether converted data is ready at the HX711.
+    * \sa autoZeroTareStart()
     *
-    * \return true if data is ready at the HX711 ADC
+    * \return true if the tare operation has not yet completed.
     */
-  inline bool isReady(void) { return (digitalRead(_pinDat) == LOW); }
+  inline bool isAutoZeroTareBusy(void) { return(_tareBusy); }
 
   /**
-   * Read next data from the HX711 device.
-   *
-   * Wait for the data to be ready at the device and then read the data into the
-   * registers. This method is most useful for polled operation.
-   *
-   * If the library is operating in interrupt mode then this immediately returns
-   * the channel that was last received from the HX711.
-   *
-   * If a non-blocking read is required, the application monitor using isReady()
-   * and only call this method when there is data available at the HX711.
-   *
-   * \sa isReady(), enableInterruptMode(), channel_t
-   *
-   * \return an indicator of which channel was last read
-   */
-  channel_t read(void);
+    * Set the noise limit for tare samples.
+    *
+    * Samples received during a tare operation that differ from the current 
+    * mean by more than this limit are rejected. If more consecutive samples 
+    * are rejected than have been accepted (eg, the first sample was noise) the
+    * operation restarts from the latest sample and the previously accepted 
+    * samples are counted as rejected.
+    *
+    * \sa autoZeroTareStart(), getZeroTareRejected()
+    *
+    * \param limit the maximum difference from the mean, 0 (default) to accept all samples.
+    */
+  inline void setAutoZeroTareLimit(int32_t limit) { _tareLimit = limit; }
 
   /**
-    * Set Tare offset for all channels from current readings.
+    * Get the standard deviation of the last tare.
     *
-    * Set the tare offset for both channels A and B by using the current values 
-    * returned from the HX711. This method averages of a small number of values 
-    * received using the the read() method and will block until the tare operation 
-    * is completed.
-    * 
-    * If interrupt mode is enabled, the mode it will be turned off while this 
-    * operation takes place and turned back on when completed.
+    * \sa autoZeroTareStart()
     *
-    * \sa read(), autoZeroTare(), getZeroTare()
+    * \param ch the channel of interest. Default channel is CH_A.
+    * \return the standard deviation of the accepted samples for the last tare operation.
+    */
+  inline uint32_t getZeroTareStdDev(channel_t ch = CH_A) { return(_chanData[ch].tareStdDev); }
+
+  /**
+    * Get the number of samples rejected in the last tare.
+    *
+    * \sa autoZeroTareStart(), setAutoZeroTareLimit()
+    *
+    * \param ch the channel of interest. Default channel is CH_A.
+    * \return the number of samples rejected as noise in the last tare operation.
     */
-  void autoZeroTare(void);
+  inline uint8_t getZeroTareRejected(channel_t ch = CH_A) { return(_tareOp.rejected[ch]); }
 
   /**
     * Set Tare offset for specific channel to a value.
@@ -309,21 +430,69 @@ public:
     * \param tare the tare offset value
     * \param ch   the channel to which this applies. Default channel is CH_A.
     */
-  inline void setZeroTare(int32_t tare, channel_t ch = CH_A) { _chanData[ch].tare = tare; }
+  void setZeroTare(int32_t tare, channel_t ch = CH_A);
 
   /**
     * Set Calibration for specific channel.
     *
     * Set the weight calibration for the channel specified to the value specified.
     * The value will be associated with the full scale calibration value.
+    * 
+    * The scale factor range/(value-tare) is worked out once from the 
+    * calibration and tare values, when they next used after they change, 
+    * and kept as a fixed point multiplier.
     *
-    * \sa autoZeroTare(), read()
+    * \sa autoZeroTare(), read(), getCalibrated(), getCalibratedFixed()
     *
     * \param value the ADC value for the range specified
     * \param range the value to be associated with the ADC calibration value
     * \param ch    the channel to which this applies. Default channel is CH_A.
     */
-  inline void setCalibration(int32_t value, float range, channel_t ch = CH_A) { _chanData[ch].calib = value; _chanData[ch].range = range; }
+  void setCalibration(int32_t value, float range, channel_t ch = CH_A);
+
+  /**
+    * Set Calibration for specific channel using an integer range.
+    *
+    * Same as setCalibration() but the range is specified as an integer. 
+    * Applications that use only this method and the integer calibrated data 
+    * methods (getCalibratedInt(), calibrateBatch(), getCalibratedFixed()) 
+    * do not need any floating point code.
+    *
+    * \sa setCalibration(), getCalibratedInt()
+    *
+    * \param value the ADC value for the range specified
+    * \param range the value to be associated with the ADC calibration value
+    * \param ch    the channel to which this applies. Default channel is CH_A.
+    */
+  void setCalibrationInt(int32_t value, int32_t range, channel_t ch = CH_A);
+
+  /**
+    * Set a calibration curve for specific channel.
+    *
+    * A calibration curve (eg, MD_HX711_CalTable) replaces the linear calibration 
+    * set by setCalibration() for load cells that are not linear. The curve 
+    * converts tared values to calibrated values, which are then returned by 
+    * getCalibrated(), getCalibratedFixed(), getCalibratedInt() and calibrateBatch().
+    * 
+    * The curve object is allocated by the application and must remain valid 
+    * while it is in use by the library.
+    *
+    * \sa setCalibration(), getCalibratedInt()
+    *
+    * \param cal pointer to the calibration curve, nullptr to use the linear calibration.
+    * \param ch  the channel to which this applies. Default channel is CH_A.
+    */
+  inline void setCalCurve(MD_HX711_Cal *cal, channel_t ch = CH_A) { _chanData[ch].cal = cal; }
+
+  /**
+    * Get the calibration curve for specific channel.
+    *
+    * \sa setCalCurve()
+    *
+    * \param ch the channel of interest. Default channel is CH_A.
+    * \return pointer to the calibration curve, nullptr if the linear calibration is used.
+    */
+  inline MD_HX711_Cal *getCalCurve(channel_t ch = CH_A) { return(_chanData[ch].cal); }
 
   /**
     * Get the current tare offset.
@@ -335,7 +504,7 @@ public:
     * \param ch the channel of interest. Default channel is CH_A.
     * \return the requested tare offset value
     */
-  inline int32_t getZeroTare(channel_t ch = CH_A) { return(_chanData[ch].tare); }
+  inline int32_t getZeroTare(channel_t ch = CH_A) { return(seqRead(_chanData[ch].tare)); }
 
   /**
     * Get the current calibration value.
@@ -359,7 +528,7 @@ public:
     * \param ch the channel of interest. Default channel is CH_A.
     * \return the requested raw value
     */
-  inline int32_t getRaw(channel_t ch = CH_A) { return(_chanData[ch].raw); }
+  inline int32_t getRaw(channel_t ch = CH_A) { return(seqRead(_chanData[ch].raw)); }
 
   /**
     * Get tared data.
@@ -371,7 +540,7 @@ public:
     * \param ch the channel of interest. Default channel is CH_A.
     * \return the requested tare adjusted value
     */
-  inline int32_t getTared(channel_t ch = CH_A) { return(_chanData[ch].raw - _chanData[ch].tare); }
+  int32_t getTared(channel_t ch = CH_A);
 
   /**
     * Get calibrated data.
@@ -384,6 +553,58 @@ public:
     * \return the requested calibration adjusted value. If the calibration is not set returns NAN
     */
   float getCalibrated(channel_t ch = CH_A);
+
+  /**
+    * Get calibrated data as a fixed point value.
+    *
+    * Get the latest raw data adjusted for tare and proportioned to the calibrated 
+    * value, as a Q16.16 fixed point number (the calibrated value multiplied by 65536).
+    * The value is worked out using only integer multiplication and shifts. 
+    * Values outside the Q16.16 range are limited to the largest positive or 
+    * negative value.
+    *
+    * \sa getCalibrated(), setCalibration()
+    *
+    * \param ch the channel of interest. Default channel is CH_A.
+    * \return the requested calibration adjusted value. If the calibration is not set returns CALIB_INVALID
+    */
+  int32_t getCalibratedFixed(channel_t ch = CH_A);
+
+  /**
+    * Get calibrated data as an integer in application units.
+    *
+    * Get the latest raw data adjusted for tare and proportioned to the calibrated 
+    * value, multiplied by unitScale and rounded to the nearest integer. For 
+    * example, if the calibration range is in grams, a unitScale of 1000 returns 
+    * the value in milligrams.
+    * 
+    * The value is worked out using only integer arithmetic, with intermediate 
+    * values wide enough for any 24 bit data and unitScale. Values that do not 
+    * fit an int32_t are limited to the largest positive or negative value.
+    *
+    * \sa calibrateBatch(), setCalibrationInt(), getCalibratedFixed()
+    *
+    * \param ch        the channel of interest. Default channel is CH_A.
+    * \param unitScale the multiplier for the calibrated value. Default 1.
+    * \return the requested calibration adjusted value. If the calibration is not set returns CALIB_INVALID
+    */
+  int32_t getCalibratedInt(channel_t ch = CH_A, uint32_t unitScale = 1);
+
+  /**
+    * Convert buffered samples to calibrated integer values.
+    *
+    * Convert an array of samples, usually from popBatch(), to tared and 
+    * calibrated values in the same way as getCalibratedInt(). The current 
+    * tare and calibration for each sample's channel are used.
+    *
+    * \sa getCalibratedInt(), popBatch()
+    *
+    * \param s         array of samples to convert.
+    * \param value     array to receive the count converted values.
+    * \param count     the number of samples to convert.
+    * \param unitScale the multiplier for the calibrated value. Default 1.
+    */
+  void calibrateBatch(const sample_t *s, int32_t *value, uint8_t count, uint32_t unitScale = 1);
     
   /**
     * Get cumulative read count.
@@ -396,36 +617,88 @@ public:
     *
     * \return the requested calibration adjusted value. If the calibration is not set returns NAN
     */
-  uint32_t getReadCount(void) { return(_readCounter); }
-  
-  /** @} */
+  uint32_t getReadCount(void) { return(seqRead(_readCounter)); }
 
-  //--------------------------------------------------------------
-  /** \name Interrupt Mode management.
-    * @{
+  /**
+    * Get the timestamp of the latest data.
+    *
+    * Each sample is timestamped when the HX711 signals that the data is ready,
+    * using the current time source. By default this is micros().
+    *
+    * \sa setTimeSource(), read()
+    *
+    * \param ch the channel of interest. Default channel is CH_A.
+    * \return the time source value when the latest data for the channel was ready.
     */
+  inline uint32_t getTimestamp(channel_t ch = CH_A) { return(seqRead(_chanData[ch].time)); }
+
   /**
-    * Control the interrupt mode.
+    * Get a consistent snapshot of the latest data.
     *
-    * Turn interrupt mode operation on or off as required.
-    * 
-    * When using interrupt mode the data received is buffered by the library. The 
-    * application can use changes in getReadCount() to determine when a new reading 
-    * has been received from the HX711 hardware.
-    * 
-    * For interrupt mode to work I/O pin connected to the HX711 data output must 
-    * support external interrupts
+    * The raw value, read count and timestamp for the channel are copied 
+    * together, guaranteed to belong to the same sample even if new data is 
+    * received (eg, in interrupt mode) while the copy is being made. 
+    * Interrupts are not disabled during the copy; it is simply repeated if 
+    * it was interrupted by new data.
+    *
+    * \sa getRaw(), getReadCount(), getTimestamp()
+    *
+    * \param s  the snapshot_t structure to receive the data.
+    * \param ch the channel of interest. Default channel is CH_A.
+    */
+  void getSnapshot(snapshot_t &s, channel_t ch = CH_A);
+
+  /**
+    * Get missed conversion count.
+    *
+    * The HX711 continuously converts data at the rate set by the RATE pin. If 
+    * the data is not read before the next conversion is completed, the earlier 
+    * data is lost. The library uses the sample timestamps and the expected 
+    * sample period to count the conversions that were lost for each channel.
     * 
-    * Interrupt mode also changes the way that read() behaves as documented 
-    * for that method.
+    * After a change of channel or gain the HX711 needs 4 conversion periods to
+    * settle and this is taken into account.
     *
-    * \sa getReadCount(), read()
+    * \sa setSamplePeriod(), getReadCount(), getOverflowCount()
     *
-    * \param enable if true enables the interrupt processing, false disables processing. Default is true.
-    * \return true if the operation successfully completed and interrupt mode is enabled.
+    * \param ch the channel of interest. Default channel is CH_A.
+    * \return the number of conversions lost since the last reset().
+    */
+  inline uint16_t getMissedCount(channel_t ch = CH_A) { return(seqRead(_chanData[ch].missed)); }
+
+  /**
+    * Set the expected sample period.
+    *
+    * Set the time between HX711 conversions, in time source units. This is 
+    * used to detect missed conversions and depends on the RATE pin setting of 
+    * the hardware. For the default micros() time source, use PERIOD_10SPS (default)
+    * or PERIOD_80SPS. Set to 0 to disable missed conversion detection.
+    *
+    * \sa getMissedCount(), setTimeSource()
+    *
+    * \param period the time between conversions in time source units.
+    */
+  inline void setSamplePeriod(uint32_t period) { _period = period; }
+
+  /**
+    * Set the time source.
+    *
+    * Set the function used to timestamp each sample. The function is called 
+    * from the interrupt handler in interrupt mode and must be short and safe 
+    * to call in that context. The default time source is micros().
+    *
+    * \sa getTimestamp()
+    *
+    * \param fn the time source function.
     */
-  bool enableInterruptMode(bool enable = true);
+  inline void setTimeSource(timeSource_t fn) { _timeSource = fn; }
+  
+  /** @} */
 
+  //--------------------------------------------------------------
+  /** \name Interrupt Mode management.
+    * @{
+    */
    /**
     * Current interrupt mode status
     * 
@@ -439,49 +712,1400 @@ public:
   
   /** @} */
 
+  //--------------------------------------------------------------
+  /** \name Asynchronous Mode management.
+    * @{
+    */
+  /**
+    * Current asynchronous mode status
+    *
+    * \sa enableAsyncMode()
+    *
+    * \return true if currently operating in asynchronous mode, false otherwise
+    */
+  inline bool isAsyncMode(void) { return(_async); }
 
-private:
-  static const uint8_t NUM_CHAN = 2;
+  /** @} */
 
-  typedef struct
-  {
-    volatile int32_t raw;    ///< raw data for Channels A/B
-    int32_t tare;   ///< the tare offset
-    int32_t calib;  ///< the calibration value for range
-    float range;    ///< the range value for the calibration
-  } channelInfo_t;
+  //--------------------------------------------------------------
+  /** \name Data filters.
+    * @{
+    */
+  /**
+    * Set the data filter for a channel.
+    *
+    * The filter (eg, MD_HX711_FilterAvg) is applied to every sample received 
+    * for the channel, in all operating modes. The filter output is kept 
+    * separately from the raw data and is retrieved using getFiltered() or 
+    * getFilteredInt(). The raw data, sample buffer and callback are not changed.
+    * 
+    * The filter is reset when it is set and restarts from the next sample 
+    * received, so it may be set before the first read. Until then getFiltered()
+    * returns the unfiltered data. The filter object is allocated by the 
+    * application and must remain valid while it is in use by the library.
+    *
+    * \sa getFiltered(), getFilteredInt()
+    *
+    * \param f  pointer to the filter, nullptr for no filter.
+    * \param ch the channel to which this applies. Default channel is CH_A.
+    */
+  void setFilter(MD_HX711_Filter *f, channel_t ch = CH_A);
 
-  uint8_t _pinClk;   ///< clock pin number
-  uint8_t _pinDat;   ///< data pin number
+  /**
+    * Get the data filter for a channel.
+    *
+    * \sa setFilter()
+    *
+    * \param ch the channel of interest. Default channel is CH_A.
+    * \return pointer to the filter, nullptr if there is no filter.
+    */
+  inline MD_HX711_Filter *getFilter(channel_t ch = CH_A) { return(_chanData[ch].filter); }
 
-  // all variables in this section must be initialized in reset()
-  bool    _enableB;       ///< channel B read enabled when true
-  mode_t  _mode;          ///< channel A current mode
-  bool    _nextReadA;     ///< if true read channel A next. Used to set the mode in the HX711.
-  volatile uint32_t _readCounter;    ///< count the number of times the HX711 has been accessed
-  channelInfo_t _chanData[NUM_CHAN];  ///< channel related data
+  /**
+    * Set the prefilter for a channel.
+    *
+    * The prefilter (eg, MD_HX711_FilterMedian) is applied to every sample 
+    * received for the channel before it is saved. Unlike the data filter set 
+    * by setFilter(), the prefilter output replaces the raw data, so it is used 
+    * for the sample buffer, callback, tare, calibration and the data filter.
+    * 
+    * The prefilter is reset when it is set. The filter object is allocated by the 
+    * application and must remain valid while it is in use by the library.
+    *
+    * \sa setFilter()
+    *
+    * \param f  pointer to the filter, nullptr for no prefilter.
+    * \param ch the channel to which this applies. Default channel is CH_A.
+    */
+  void setPreFilter(MD_HX711_Filter *f, channel_t ch = CH_A);
 
-  // Private helper methods
-  void powerDown(void);   ///< power down the HX711
-  void powerUp(void);     ///< power up the HX711
-  int32_t HX711ReadData(uint8_t mode);   ///< read data from HX711 and set extra mode bits
+  /**
+    * Get the prefilter for a channel.
+    *
+    * \sa setPreFilter()
+    *
+    * \param ch the channel of interest. Default channel is CH_A.
+    * \return pointer to the prefilter, nullptr if there is no prefilter.
+    */
+  inline MD_HX711_Filter *getPreFilter(channel_t ch = CH_A) { return(_chanData[ch].preFilter); }
 
-  // ISR related private data
-  uint8_t _myISRId;       ///< my instance ISR Id for myInstance[x] and global ISRx
-  bool _inISR;            ///< set true when currently processing ISR
+  /**
+    * Get filtered tared data.
+    *
+    * Get the latest filter output adjusted for the tare for the specified 
+    * channel. If no filter is set this is the same as getTared().
+    *
+    * \sa setFilter(), getTared()
+    *
+    * \param ch the channel of interest. Default channel is CH_A.
+    * \return the filtered tare adjusted value
+    */
+  int32_t getFiltered(channel_t ch = CH_A);
 
-  // IRQ related global data
-  static uint8_t ISRUsed;        ///< Keep track of which ISRs are used (global bit field)
-  static MD_HX711* myInstance[]; ///< Callback instance for the ISR to reach instanceISR()
+  /**
+    * Get filtered calibrated data as an integer.
+    *
+    * Get the latest filter output adjusted for tare and calibration, in the 
+    * same way as getCalibratedInt().
+    *
+    * \sa setFilter(), getCalibratedInt()
+    *
+    * \param ch        the channel of interest. Default channel is CH_A.
+    * \param unitScale the multiplier for the calibrated value. Default 1.
+    * \return the filtered calibrated value. If the calibration is not set returns CALIB_INVALID
+    */
+  int32_t getFilteredInt(channel_t ch = CH_A, uint32_t unitScale = 1);
 
-  // IRQ support functions 
-  bool enableISR(void);   ///< Attach the ISR and start processing as interrupts
-  void disableISR(void);  ///< Detach the ISR and stop processing interrupts
-  void readNB(void);      ///< Non-blocking read the HX711 in IRQ safe mode
+  /** @} */
 
-  // Prototype all the [MAX_INSTANCE] encoder ISRs
-  static void globalISR0(void);
-  static void globalISR1(void);
-  static void globalISR2(void);
-  static void globalISR3(void);
+  //--------------------------------------------------------------
+  /** \name Sample Buffer management.
+    * @{
+    */
+  /**
+    * Set the sample buffer.
+    *
+    * Nominate the storage for the sample buffer. When a buffer is set, every 
+    * sample received from the HX711 is also queued in the buffer until it is 
+    * removed by the application using pop() or popBatch(). This ensures that no 
+    * data is lost when the application is not able to process each sample before 
+    * the next one is received (eg, in interrupt mode).
+    * 
+    * The buffer is a single-producer/single-consumer queue that is safe to use 
+    * between the ISR and the main application without disabling interrupts. 
+    * If the buffer is full when a sample is received, the sample is not queued 
+    * and the overflow count is incremented.
+    * 
+    * The buffer memory is allocated by the application and must remain valid 
+    * while it is in use by the library.
+    *
+    * \sa available(), pop(), popBatch(), getOverflowCount()
+    *
+    * \param buf  pointer to the buffer storage or nullptr to disable buffering.
+    * \param size the number of sample_t elements in buf. Must be a power of 2 no greater than 128.
+    * \return true if the buffer was accepted, false if size is not valid.
+    */
+  bool setBuffer(sample_t *buf, uint8_t size);
+
+  /**
+    * Get the number of buffered samples.
+    *
+    * \sa setBuffer(), pop(), popBatch()
+    *
+    * \return the number of samples waiting in the buffer.
+    */
+  inline uint8_t available(void) { return(_bufHead - _bufTail); }
+
+  /**
+    * Remove the oldest sample from the buffer.
+    *
+    * \sa setBuffer(), available(), popBatch()
+    *
+    * \param s the sample_t structure to receive the data.
+    * \return true if a sample was returned, false if the buffer is empty.
+    */
+  bool pop(sample_t &s);
+
+  /**
+    * Remove multiple samples from the buffer.
+    *
+    * Remove up to the specified number of samples from the buffer, oldest first.
+    *
+    * \sa setBuffer(), available(), pop()
+    *
+    * \param s   array of sample_t structures to receive the data.
+    * \param max the maximum number of samples to return.
+    * \return the number of samples returned in s.
+    */
+  uint8_t popBatch(sample_t *s, uint8_t max);
+
+  /**
+    * Get buffer overflow count.
+    *
+    * The overflow count is incremented each time a sample is received from 
+    * the HX711 and cannot be queued because the buffer is full.
+    *
+    * \sa setBuffer()
+    *
+    * \return the number of samples not queued since the last reset().
+    */
+  inline uint16_t getOverflowCount(void) { return(seqRead(_bufOverflow)); }
+
+  /** @} */
+
+  //--------------------------------------------------------------
+  /** \name New Data Notification.
+    * @{
+    */
+  /**
+    * Set the new sample callback.
+    *
+    * Register a function to be called when new data is received from the 
+    * HX711, removing the need for the application to poll getReadCount().
+    * 
+    * If immediate is true the callback is invoked as soon as the data is 
+    * saved, which is from the ISR in interrupt mode. The callback must then 
+    * be short and safe to call from an interrupt handler.
+    * 
+    * Otherwise the callback is deferred and invoked from service(). If a 
+    * sample buffer is set, service() invokes the callback for each buffered 
+    * sample (removing it from the buffer), otherwise only for the latest sample.
+    *
+    * \sa service(), setBuffer()
+    *
+    * \param cb        the callback function or nullptr to disable callbacks.
+    * \param immediate true to invoke the callback when the data is saved, false to invoke from service().
+    */
+  void setCallback(cbSample_t cb, bool immediate = false);
+
+  /** @} */
+
+
+protected:
+  /**
+   * Class Constructor
+   *
+   * Set the internal shared variables to default values. Only used by
+   * the derived classes.
+   */
+  MD_HX711Base(void) :
+      _timeSource(micros), _period(PERIOD_10SPS), _async(false), _asyncEdge(0),
+      _buf(nullptr), _bufMask(0), _cb(nullptr), _cbImmediate(false),
+      _myISRId(UINT8_MAX), _inISR(false)
+  {}
+
+  /**
+   * Clock the data out of the HX711 and set the mode for the next read.
+   * 
+   * This is the common protocol implementation used for all types of 
+   * I/O. The IO class must implement the inline methods clkHigh(), 
+   * clkLow() and datHigh(i) to access the hardware, where i selects one 
+   * of N DAT lines sampled on the same CLK edge. A single device has N = 1.
+   * 
+   * If shortMask is true, interrupts are only disabled while CLK is high
+   * as this is the part of the cycle constrained by the HX711 60us power 
+   * down time. Otherwise the caller is responsible for interrupt masking.
+   * 
+   * \tparam N       the number of DAT lines read.
+   * \param io        the I/O object used to access the CLK and DAT pins.
+   * \param value     array of N values for the unprocessed 24 bit data read from each DAT line.
+   * \param mode      the number of extra clock pulses (1 to 3) after the data bits.
+   * \param shortMask true if interrupts are to be disabled only while CLK is high.
+   */
+  template <uint8_t N, class IO> static void HX711Shift(IO &io, int32_t *value, uint8_t mode, bool shortMask)
+  {
+    // data read controls
+    uint32_t mask = 0x800000L;
+
+    for (uint8_t i = 0; i < N; i++)
+      value[i] = 0;
+
+    do   // Read data bits from the HX711
+    {
+      if (shortMask) noInterrupts();
+      io.clkHigh();
+      delayMicroseconds(1);   // T2 typ 1us
+
+      for (uint8_t i = 0; i < N; i++)
+        if (io.datHigh(i)) value[i] |= mask;
+      io.clkLow();
+      if (shortMask) interrupts();
+
+      delayMicroseconds(1);  // T3 typ 1us
+      mask >>= 1;
+    } while (mask > 0);
+
+    // Set the mode for the next read (just keep clocking)
+    do
+    {
+      if (shortMask) noInterrupts();
+      io.clkHigh();
+      delayMicroseconds(1);
+      io.clkLow();
+      if (shortMask) interrupts();
+      delayMicroseconds(1);
+      mode--;
+    } while (mode > 0);
+  }
+
+  /**
+   * Return the number of extra clock pulses that select the next conversion.
+   * 
+   * \param readA true if Channel A is to be read next.
+   * \param mode  the Channel A gain.
+   * \return the number of extra clock pulses after the data bits (1 to 3).
+   */
+  static uint8_t modeExtras(bool readA, mode_t mode)
+  {
+    if (!readA)                return(2); // Channel B gain 32
+    else if (mode == GAIN_128) return(1); // Channel A gain 128
+    else                       return(3); // Channel A gain 64
+  }
+
+  bool _shortMask;    ///< disable interrupts only while CLK is high during a read
+
+private:
+  static const uint8_t NUM_CHAN = 2;
+
+  typedef struct
+  {
+    volatile int32_t raw;    ///< raw data for Channels A/B
+    volatile uint32_t time;  ///< timestamp for the raw data
+    volatile uint32_t count; ///< read count when the raw data was received
+    volatile uint16_t missed; ///< count of missed conversions
+    volatile int32_t tare;   ///< the tare offset
+    uint32_t tareStdDev;     ///< standard deviation of the last tare operation
+    int32_t calib;  ///< the calibration value for range
+    int32_t rangeM; ///< the range value for the calibration, mantissa
+    int8_t rangeE;  ///< the range value for the calibration, binary exponent
+    volatile bool fixedValid; ///< false when mult and shift need to be recalculated
+    volatile bool floatValid; ///< false when scale needs to be recalculated
+    int32_t mult;   ///< scale factor multiplier, 0 when not calibrated
+    int16_t shift;  ///< scale factor binary shift, calibrated = (tared * mult) >> shift
+    float scale;    ///< scale factor as a float
+    MD_HX711_Cal *cal; ///< calibration curve, nullptr for linear calibration
+    MD_HX711_Filter *preFilter; ///< prefilter, nullptr for none
+    MD_HX711_Filter *filter;   ///< data filter, nullptr for none
+    volatile int32_t filtered; ///< latest filter output
+  } channelInfo_t;
+
+  typedef struct
+  {
+    uint8_t samples;            ///< number of samples for each channel
+    bool    enableB;            ///< channel B enable setting to restore after the tare
+    int32_t ref[NUM_CHAN];      ///< reference value (first sample)
+    int64_t sum[NUM_CHAN];      ///< sum of differences from ref
+    int64_t sumSq[NUM_CHAN];    ///< sum of squared differences from ref
+    uint8_t count[NUM_CHAN];    ///< samples accepted
+    uint8_t rejected[NUM_CHAN]; ///< samples rejected
+    uint8_t run[NUM_CHAN];      ///< consecutive samples rejected
+  } tareOp_t;
+
+  timeSource_t _timeSource;  ///< timestamp source for samples
+  uint32_t _period;          ///< expected time between conversions
+
+  // all variables in this section must be initialized in reset()
+  bool    _enableB;       ///< channel B read enabled when true
+  mode_t  _mode;          ///< channel A current mode
+  bool    _nextReadA;     ///< if true read channel A next. Used to set the mode in the HX711.
+  volatile uint32_t _readCounter;    ///< count the number of times the HX711 has been accessed
+  volatile uint8_t _seq;         ///< sequence counter, odd while saveData() is updating the data
+  volatile channel_t _lastCh;    ///< channel of the last data saved
+  uint32_t _lastTime;     ///< timestamp of the last data received
+  bool    _lastTimeValid; ///< true if _lastTime can be used to check for missed conversions
+  uint8_t _lastExtras;    ///< extra clock pulses sent on the last read
+  bool    _settleNext;    ///< the conversion after the last read needs settling time
+  bool    _settleThis;    ///< the conversion being read needs settling time
+  channel_t _readingCh;   ///< channel of the conversion being read, set by nextReadMode()
+  uint8_t _readingExtras; ///< extra clock pulses that set the mode of the conversion being read
+
+  // tare operation state
+  volatile bool _tareBusy; ///< true while a tare operation is in progress
+  int32_t _tareLimit;     ///< noise limit for tare samples, 0 for none
+  tareOp_t _tareOp;       ///< the tare operation in progress (or last completed)
+
+  // asynchronous mode state
+  volatile bool _async;   ///< true if in asynchronous mode
+  uint8_t _asyncEdge;     ///< CLK edge count for the current read cycle, 0 when idle
+  uint8_t _asyncEdges;    ///< total CLK edges for the current read cycle
+  int32_t _asyncValue;    ///< data being assembled during the current read cycle
+  uint32_t _asyncTime;    ///< timestamp for the current read cycle
+  channelInfo_t _chanData[NUM_CHAN];  ///< channel related data
+  volatile uint8_t _bufHead;     ///< buffer write index, only changed by saveData()
+  volatile uint8_t _bufTail;     ///< buffer read index, only changed by pop()
+  volatile uint16_t _bufOverflow; ///< count of samples lost due to full buffer
+
+  // sample buffer
+  sample_t *_buf;     ///< sample buffer storage
+  uint8_t _bufMask;   ///< index mask for buffer (size-1)
+
+  // new data callback
+  cbSample_t _cb;     ///< new data callback function
+  bool _cbImmediate;  ///< true if the callback is invoked from saveData()
+  uint32_t _cbCount;  ///< read count last processed by service()
+
+  // ISR related private data
+  typedef void (*ISRFunc_t)(void);  ///< ISR function pointer type
+  uint8_t _myISRId;       ///< my instance ISR Id for myInstance[x] and globalISR<x>
+#if !HX711_ISR_ARG
+  ISRFunc_t _myISR;       ///< my ISR function, set when interrupt mode is enabled
+  static MD_HX711Base* myInstance[HX711_MAX_INSTANCE]; ///< Callback instance for the ISR to reach readNB()
+#endif
+  volatile bool _inISR;   ///< set true when currently processing ISR
+
+#if defined(ONLOW)
+  static const uint8_t ISR_TRIGGER = ONLOW;  ///< level triggered IRQ (ESP cores)
+#else
+  static const uint8_t ISR_TRIGGER = LOW;    ///< level triggered IRQ
+#endif
+
+  // support functions 
+  void tareData(channel_t ch, int32_t value);  ///< process a sample for the tare operation
+  static uint32_t isqrt(uint64_t v);           ///< integer square root
+  void checkScale(channel_t ch);               ///< recalculate the fixed scale factor if needed
+  static int32_t mulShift(int32_t x, int32_t mult, int16_t shift, uint32_t unit = 1);  ///< rounded and limited (x * mult * unit) >> shift
+  void setRange(int32_t value, int32_t m, int8_t e, channel_t ch);  ///< save calibration with range m * 2^e
+  int32_t calibrateInt(channel_t ch, int32_t tared, int8_t q, uint32_t unit);  ///< tared to calibrated * unit * 2^q
+  uint8_t nextReadMode(void);    ///< set up the next read channel and return the extra clock pulses
+  void saveData(int32_t value, uint32_t time);  ///< save the data just read from the HX711
+  void resetData(void);          ///< set the library defaults
+  void serviceCallback(void);    ///< pass new data to the deferred callback
+
+  template <uint8_t N> friend class MD_HX711Array;
+  template <class BUS> friend class MD_HX711B;
+
+  /**
+   * Read a value updated by saveData() without tearing.
+   * 
+   * Multi-byte values may be changed by the ISR part way through being read
+   * by the application. The read is repeated until the sequence counter shows 
+   * that the data did not change during the read.
+   */
+  template <typename T> T seqRead(volatile T &v)
+  {
+    uint8_t seq;
+    T value;
+
+    do
+    {
+      while ((seq = _seq) & 1) { }  // wait out an update in progress
+      value = v;
+    } while (seq != _seq);
+
+    return(value);
+  }
+};
+
+/**
+ * Standard I/O bus for CLK and DAT pins set at run time.
+ *
+ * This is the bus policy used by MD_HX711. The pins are accessed using the
+ * standard digitalWrite() and digitalRead() functions, which work on all
+ * architectures.
+ */
+class MD_HX711_PinBus
+{
+public:
+  /**
+   * Class Constructor
+   *
+   * \param pinClk pin used for SCK/CLK signal.
+   * \param pinDat pin used for DAT/SD signal.
+   */
+  MD_HX711_PinBus(uint8_t pinClk, uint8_t pinDat) : _pinClk(pinClk), _pinDat(pinDat) {}
+
+  inline uint8_t pinClk(void) const { return(_pinClk); }  ///< CLK pin number
+  inline uint8_t pinDat(void) const { return(_pinDat); }  ///< DAT pin number
+  inline void begin(void) { pinMode(_pinClk, OUTPUT); pinMode(_pinDat, INPUT); } ///< initialize the bus
+  inline void clkHigh(void) { digitalWrite(_pinClk, HIGH); }          ///< set CLK high
+  inline void clkLow(void)  { digitalWrite(_pinClk, LOW); }           ///< set CLK low
+  inline bool datHigh(void) { return(digitalRead(_pinDat) == HIGH); } ///< return true if DAT is high
+
+private:
+  uint8_t _pinClk;   ///< clock pin number
+  uint8_t _pinDat;   ///< data pin number
+};
+
+/**
+ * Fast I/O access for a pin known at compile time.
+ * 
+ * For ATmega328/168 based boards (eg, Uno, Nano) the port registers and bit 
+ * masks are resolved at compile time and the pin is accessed with single 
+ * bit set/clear instructions. For other AVR boards the registers and mask
+ * are looked up once in begin() and cached. Other architectures fall back
+ * to the standard digitalWrite()/digitalRead() functions.
+ * 
+ * \tparam PIN the Arduino pin number.
+ */
+template <uint8_t PIN> class MD_HX711_Pin
+{
+public:
+#if defined(__AVR_ATmega328P__) || defined(__AVR_ATmega328__) || defined(__AVR_ATmega168__) || defined(__AVR_ATmega168P__) || defined(__AVR_ATmega88__)
+  inline void begin(void) {}
+  inline void high(void) { out() |= mask(); }
+  inline void low(void)  { out() &= ~mask(); }
+  inline bool isHigh(void) { return((in() & mask()) != 0); }
+
+private:
+  static inline volatile uint8_t &out(void) { return(PIN < 8 ? PORTD : (PIN < 14 ? PORTB : PORTC)); }
+  static inline volatile uint8_t &in(void)  { return(PIN < 8 ? PIND  : (PIN < 14 ? PINB  : PINC)); }
+  static inline uint8_t mask(void) { return(_BV(PIN < 8 ? PIN : (PIN < 14 ? PIN - 8 : PIN - 14))); }
+
+#elif defined(__AVR__)
+  inline void begin(void) 
+  { 
+    _out = portOutputRegister(digitalPinToPort(PIN)); 
+    _in = portInputRegister(digitalPinToPort(PIN));
+    _mask = digitalPinToBitMask(PIN);
+  }
+  inline void high(void) { *_out |= _mask; }
+  inline void low(void)  { *_out &= ~_mask; }
+  inline bool isHigh(void) { return((*_in & _mask) != 0); }
+
+private:
+  volatile uint8_t *_out; ///< cached output register
+  volatile uint8_t *_in;  ///< cached input register
+  uint8_t _mask;          ///< cached bit mask for the pin
+
+#else
+  inline void begin(void) {}
+  inline void high(void) { digitalWrite(PIN, HIGH); }
+  inline void low(void)  { digitalWrite(PIN, LOW); }
+  inline bool isHigh(void) { return(digitalRead(PIN) == HIGH); }
+#endif
+};
+
+/**
+ * Fast I/O bus for CLK and DAT pins known at compile time.
+ * 
+ * This is the bus policy used by MD_HX711T. The pins are accessed through
+ * MD_HX711_Pin, directly using the processor port registers where possible.
+ * 
+ * \tparam PIN_CLK pin used for SCK/CLK signal.
+ * \tparam PIN_DAT pin used for DAT/SD signal.
+ */
+template <uint8_t PIN_CLK, uint8_t PIN_DAT> class MD_HX711_FastBus
+{
+public:
+  inline uint8_t pinClk(void) const { return(PIN_CLK); }  ///< CLK pin number
+  inline uint8_t pinDat(void) const { return(PIN_DAT); }  ///< DAT pin number
+  inline void begin(void) { pinMode(PIN_CLK, OUTPUT); pinMode(PIN_DAT, INPUT); _clk.begin(); _dat.begin(); } ///< initialize the bus
+  inline void clkHigh(void) { _clk.high(); }              ///< set CLK high
+  inline void clkLow(void)  { _clk.low(); }               ///< set CLK low
+  inline bool datHigh(void) { return(_dat.isHigh()); }    ///< return true if DAT is high
+
+private:
+  MD_HX711_Pin<PIN_CLK> _clk;  ///< CLK pin
+  MD_HX711_Pin<PIN_DAT> _dat;  ///< DAT pin
+};
+
+/**
+ * Simulated bus for HX711 device models.
+ * 
+ * This bus policy connects the library to an object implementing the 
+ * MD_HX711_SimBus::device_t interface rather than physical pins. It is 
+ * used to run and test the library without hardware (eg, on a host 
+ * computer), together with a device model such as MD_HX711_Sim.
+ */
+class MD_HX711_SimBus
+{
+public:
+  /**
+   * Simulated device interface.
+   * 
+   * A device model implements this interface to receive the CLK signal 
+   * and provide the DAT signal.
+   */
+  class device_t
+  {
+  public:
+    virtual ~device_t(void) {}
+    virtual void clk(bool high) = 0;  ///< CLK changed to the level specified
+    virtual bool dat(void) = 0;       ///< return the current DAT level, true if high
+  };
+
+  /**
+   * Class Constructor
+   * 
+   * \param dev the device model connected to the bus.
+   */
+  MD_HX711_SimBus(device_t *dev = nullptr) : _dev(dev) {}
+
+  inline uint8_t pinClk(void) const { return(UINT8_MAX); }  ///< CLK pin number (none)
+  inline uint8_t pinDat(void) const { return(UINT8_MAX); }  ///< DAT pin number (none)
+  inline void begin(void) {}                                ///< initialize the bus
+  inline void clkHigh(void) { _dev->clk(true); }            ///< set CLK high
+  inline void clkLow(void)  { _dev->clk(false); }           ///< set CLK low
+  inline bool datHigh(void) { return(_dev->dat()); }        ///< return true if DAT is high
+
+private:
+  device_t *_dev;   ///< the simulated device
+};
+
+/**
+ * MD_HX711 object using a bus policy for hardware access.
+ * 
+ * This template class implements the HX711 hardware access for all the 
+ * MD_HX711 objects. All access to the CLK and DAT signals is through the 
+ * BUS policy class, fixed at compile time. The policy methods are inlined 
+ * into the HX711 protocol so there is no function call overhead for each 
+ * CLK edge, and there are no virtual functions.
+ * 
+ * The BUS class must implement the methods
+ * - uint8_t pinClk() and uint8_t pinDat() returning the pin numbers used (for 
+ *   interrupt mode), or UINT8_MAX if not applicable.
+ * - void begin() to initialize the bus (eg, set the pin modes).
+ * - void clkHigh() and void clkLow() to set the CLK signal.
+ * - bool datHigh() returning true if the DAT signal is high.
+ * 
+ * The library provides MD_HX711_PinBus (standard I/O, see MD_HX711), 
+ * MD_HX711_FastBus (direct port I/O, see MD_HX711T) and MD_HX711_SimBus 
+ * (simulated devices). Other buses (eg, Linux GPIO) can be implemented by 
+ * the application.
+ * 
+ * \tparam BUS the bus policy class.
+ */
+template <class BUS> class MD_HX711B : public MD_HX711Base
+{
+public:
+  //--------------------------------------------------------------
+  /** \name Class constructor and destructor.
+   * @{
+   */
+  /**
+   * Class Constructor
+   *
+   * Instantiate a new instance of the class.
+   * 
+   * \param bus the bus object to use.
+   */
+  MD_HX711B(const BUS &bus = BUS()) : _bus(bus) {}
+
+  /**
+   * Class Destructor.
+   *
+   * Release any allocated memory and clean up anything else as required.
+   */
+  ~MD_HX711B(void) { disableISR(); }
+
+  /** @} */
+
+  //--------------------------------------------------------------
+  /** \name Methods for hardware control.
+   * @{
+   */
+  /**
+   * Initialize the object.
+   *
+   * Initialize the bus and the object data. This needs to be called during 
+   * setup() to set and initialize items that cannot be done during object 
+   * creation.
+   * 
+   * A reset() is performed as part of this method.
+   * 
+   * \sa reset()
+   */
+  void begin(void);
+
+  /**
+   * Reset the HX711 hardware and library defaults.
+   *
+   * The HX711 Hardware is reset according to the protocol described in the data sheet
+   * \ref pageControl. The library internal values and modes are also reset to default.
+   *
+   * \sa \ref pageControl
+   */
+  void reset(void);
+
+  /** @} */
+
+  //--------------------------------------------------------------
+  /** \name Methods for Data management.
+   * @{
+   */
+  /**
+   * Return status of data ready at HX711
+   *
+   * Return boolean status of whether converted data is ready at the HX711.
+   *
+   * \return true if data is ready at the HX711 ADC
+   */
+  inline bool isReady(void) { return(!_bus.datHigh()); }
+
+  /**
+   * Read next data from the HX711 device.
+   *
+   * Wait for the data to be ready at the device and then read the data into the
+   * registers. This method is most useful for polled operation.
+   *
+   * If the library is operating in interrupt mode then this immediately returns
+   * the channel that was last received from the HX711.
+   *
+   * If a non-blocking read is required, the application monitor using isReady()
+   * and only call this method when there is data available at the HX711.
+   *
+   * \sa isReady(), enableInterruptMode(), channel_t
+   *
+   * \return an indicator of which channel was last read
+   */
+  channel_t read(void);
+
+  /**
+    * Set Tare offset for all channels from current readings.
+    *
+    * Set the tare offset for both channels A and B by averaging the specified 
+    * number of samples received from the HX711. This method will block until 
+    * the tare operation is completed.
+    * 
+    * In interrupt or asynchronous mode the samples continue to be received 
+    * in that mode. In polled mode the read() method is used to get the data.
+    *
+    * \sa autoZeroTareStart(), getZeroTare(), getZeroTareStdDev()
+    * 
+    * \param samples the number of samples to average for each channel. Default TARE_SAMPLES.
+    */
+  void autoZeroTare(uint8_t samples = TARE_SAMPLES);
+
+  /** @} */
+
+  //--------------------------------------------------------------
+  /** \name Interrupt Mode management.
+    * @{
+    */
+  /**
+    * Control the interrupt mode.
+    *
+    * Turn interrupt mode operation on or off as required.
+    * 
+    * When using interrupt mode the data received is buffered by the library. The 
+    * application can use changes in getReadCount() to determine when a new reading 
+    * has been received from the HX711 hardware.
+    * 
+    * For interrupt mode to work I/O pin connected to the HX711 data output must 
+    * support external interrupts
+    * 
+    * Interrupt mode also changes the way that read() behaves as documented 
+    * for that method.
+    *
+    * \sa getReadCount(), read()
+    *
+    * \param enable if true enables the interrupt processing, false disables processing. Default is true.
+    * \return true if the operation successfully completed and interrupt mode is enabled.
+    */
+  bool enableInterruptMode(bool enable = true) { if (enable) return(enableISR()); disableISR(); return(true); }
+
+  /** @} */
+
+  //--------------------------------------------------------------
+  /** \name Asynchronous Mode management.
+    * @{
+    */
+  /**
+    * Control the asynchronous mode.
+    *
+    * Turn asynchronous mode operation on or off as required. Interrupt mode 
+    * is turned off when asynchronous mode is enabled.
+    * 
+    * In asynchronous mode the HX711 read cycle is advanced by one CLK edge 
+    * each time asyncTick() is called, normally from a periodic hardware timer 
+    * interrupt set up by the application. The processor is free between the
+    * CLK edges rather than waiting in delays.
+    * 
+    * When a read cycle is completed the data is saved in the same way as 
+    * other modes, updating getReadCount() and invoking the new data callback. 
+    * Asynchronous mode changes the way that read() behaves in the same way 
+    * as interrupt mode.
+    *
+    * \sa asyncTick(), setCallback(), getReadCount()
+    *
+    * \param enable if true enables asynchronous mode, false disables it. Default is true.
+    */
+  void enableAsyncMode(bool enable = true);
+
+  /**
+    * Advance the asynchronous read by one CLK edge.
+    *
+    * This method is called periodically by the application, normally from 
+    * a timer interrupt, when the library is in asynchronous mode. It returns
+    * immediately if asynchronous mode is not enabled.
+    * 
+    * When idle, it checks if the HX711 has data ready and starts a read cycle. 
+    * During a read cycle each call changes the state of CLK, sampling DAT 
+    * before each falling edge. A read cycle needs 50 to 54 calls to complete.
+    * 
+    * As CLK is held HIGH between two calls, the time between calls must be 
+    * shorter than the 60us HX711 power down time. A period between 10us and
+    * 40us is recommended.
+    *
+    * \sa enableAsyncMode()
+    */
+  inline void asyncTick(void) { if (_async) asyncEdge(); }
+
+  /** @} */
+
+  //--------------------------------------------------------------
+  /** \name New Data Notification.
+    * @{
+    */
+  /**
+    * Service the library.
+    *
+    * This method should be called every time through loop() when using a 
+    * deferred callback. In polled mode, the HX711 is read if data is ready. 
+    * Any new data is then passed to the callback.
+    *
+    * \sa setCallback()
+    */
+  void service(void);
+
+  /** @} */
+
+protected:
+  void powerDown(void) { _bus.clkHigh(); delayMicroseconds(64); }   ///< power down the HX711, CLK high for at least 60us
+  void powerUp(void) { _bus.clkLow(); }     ///< power up the HX711
+  int32_t HX711ReadData(uint8_t mode)   ///< read data from HX711 and set extra mode bits
+  { 
+    int32_t value;
+    BusIO io = { _bus };
+
+    HX711Shift<1>(io, &value, mode, _shortMask);
+    return(value);
+  }
+
+  BUS _bus;   ///< the bus used to access the HX711
+
+private:
+  // adapt the single DAT line BUS to the HX711Shift() I/O interface
+  struct BusIO
+  {
+    BUS &bus;
+    inline void clkHigh(void) { bus.clkHigh(); }
+    inline void clkLow(void)  { bus.clkLow(); }
+    inline bool datHigh(uint8_t) { return(bus.datHigh()); }
+  };
+
+#if HX711_ISR_ARG
+  static void argISR(void *arg) { ((MD_HX711B *)arg)->readNB(); }   ///< ISR using attachInterruptArg() to reach readNB()
+#else
+  // ISR trampoline for each myISRId
+  template <uint8_t ID> static void globalISR(void) { ((MD_HX711B *)myInstance[ID])->readNB(); }
+
+  // return the address of globalISR<id>, for id < N
+  template <uint8_t N, bool D = true> struct ISRFunc 
+  { 
+    static ISRFunc_t get(uint8_t id) { return(id == N - 1 ? globalISR<N - 1> : ISRFunc<N - 1>::get(id)); } 
+  };
+  template <bool D> struct ISRFunc<0, D> { static ISRFunc_t get(uint8_t) { return(nullptr); } };
+#endif
+
+  bool enableISR(void);   ///< Attach the ISR and start processing as interrupts
+  void disableISR(void);  ///< Detach the ISR and stop processing interrupts
+  void readNB(void);      ///< Non-blocking read the HX711 in IRQ safe mode
+  void asyncEdge(void);   ///< advance the async read cycle by one CLK edge
+};
+
+template <class BUS> void MD_HX711B<BUS>::begin(void)
+{
+  _bus.begin();
+
+  if (isInterruptMode())
+    disableISR();
+
+  reset();
+}
+
+template <class BUS> void MD_HX711B<BUS>::reset(void)
+// stop background reads, power cycle the hardware and set defaults
+{
+  disableISR();
+  enableAsyncMode(false);
+  powerDown();
+  powerUp();
+  resetData();
+}
+
+template <class BUS> bool MD_HX711B<BUS>::enableISR(void)
+// Enable the ISR on this pin instance
+{
+  int8_t irq = digitalPinToInterrupt(_bus.pinDat());
+
+  if (isInterruptMode()) return(false);
+
+  // check if pin can be used for ISR
+  if (irq != NOT_AN_INTERRUPT)
+  {
+#if HX711_ISR_ARG
+    // the core passes this instance to the ISR, no table needed
+    _myISRId = 0;
+    attachInterruptArg(irq, argISR, this, ISR_TRIGGER);
+#else
+    // assign ourselves a ISR ID ...
+    for (uint8_t i = 0; i < HX711_MAX_INSTANCE; i++)
+    {
+      if (myInstance[i] == nullptr)  // found a free ISR Id?
+      {
+        _myISRId = i;                // remember who this instance is
+        myInstance[_myISRId] = this; // record this instance
+        break;
+      }
+    }
+
+    // ... and attach the corresponding ISR trampoline
+    if (_myISRId != UINT8_MAX)   // we found one
+    {
+      _myISR = ISRFunc<HX711_MAX_INSTANCE>::get(_myISRId);
+      attachInterrupt(irq, _myISR, ISR_TRIGGER);
+    }
+    else
+      irq = NOT_AN_INTERRUPT;
+#endif
+
+    if (irq != NOT_AN_INTERRUPT)
+    {
+      powerDown();    // reset the hardware
+      powerUp();
+      _lastTimeValid = false;   // restarting the conversions
+      _lastExtras = 1;          // in the hardware reset mode (A128)
+    }
+  }
+
+  return(irq != NOT_AN_INTERRUPT);
+}
+
+template <class BUS> void MD_HX711B<BUS>::disableISR(void)
+// Disable the ISR on this pin instance and free up the ISR slot
+{
+  if (isInterruptMode())
+  {
+    while (_inISR) { yield(); } ;   // wait for any current IRQ to stop
+
+    noInterrupts();         // stop IRQs that may access this table while reorganizing
+
+    detachInterrupt(digitalPinToInterrupt(_bus.pinDat()));
+#if !HX711_ISR_ARG
+    myInstance[_myISRId] = nullptr;   // free up the ISR slot for someone else
+#endif
+
+    interrupts();     // IRQs can access again
+  }
+
+  // reset global indicators
+  _myISRId = UINT8_MAX;
+  _inISR = false;
+}
+
+template <class BUS> void MD_HX711B<BUS>::autoZeroTare(uint8_t samples)
+// Blocking tare operation
+{
+  autoZeroTareStart(samples);
+
+  while (_tareBusy)
+  {
+    if (isInterruptMode() || _async)
+      yield();    // data is being received in the background
+    else
+      read();
+  }
+}
+
+template <class BUS> MD_HX711Base::channel_t MD_HX711B<BUS>::read(void)
+// Blocking read. The method waits for the HX711 to tell us it has data.
+// If operating in interrupt or async mode it immediately returns.
+{
+  // check for interrupt or async mode
+  if (!isInterruptMode() && !_async)
+  {
+    // blocking wait to make sure we have data to read
+    while (!isReady()) { yield(); }
+
+    // do the actual non-blocking read
+    readNB();
+  }
+
+  // the channel we have just read informs the return code
+  return(_lastCh);
+}
+
+template <class BUS> void MD_HX711B<BUS>::enableAsyncMode(bool enable)
+// Turn asynchronous mode on or off
+{
+  if (enable)
+  {
+    if (isInterruptMode()) disableISR();
+    _asyncEdge = 0;
+    _async = true;
+  }
+  else if (_async)
+  {
+    // stop asyncTick() and then finish any read cycle in progress 
+    // so the HX711 receives a valid number of CLK pulses. Interrupts 
+    // are only disabled while CLK is high, as for asyncTick().
+    noInterrupts();
+    _async = false;
+    interrupts();
+    while (_asyncEdge != 0)
+    {
+      noInterrupts();
+      asyncEdge();        // CLK high, or low if asyncTick() left it high
+      if (_asyncEdge & 1)
+      {
+        delayMicroseconds(1);
+        asyncEdge();      // sample DAT and CLK low
+      }
+      interrupts();
+      delayMicroseconds(1);
+    }
+  }
+  else
+    _asyncEdge = 0;
+}
+
+template <class BUS> void MD_HX711B<BUS>::asyncEdge(void)
+// Advance the read cycle by one CLK edge.
+// Odd edge counts are rising edges, even are falling edges.
+{
+  if (_asyncEdge == 0)
+  {
+    // idle - check if we need to start a new read cycle
+    if (!isReady()) return;
+
+    _asyncTime = _timeSource();   // DAT is low now
+    _asyncEdges = 2 * (24 + nextReadMode());
+    _asyncValue = 0;
+  }
+
+  if ((_asyncEdge & 1) == 0)  // CLK is low, set it high
+  {
+    _bus.clkHigh();
+    _asyncEdge++;
+  }
+  else                        // CLK is high, sample DAT and set it low
+  {
+    if (_asyncEdge < 2 * 24)
+    {
+      _asyncValue <<= 1;
+      if (_bus.datHigh()) _asyncValue |= 1;
+    }
+    _bus.clkLow();
+    _asyncEdge++;
+
+    // check if we are done
+    if (_asyncEdge == _asyncEdges)
+    {
+      _asyncEdge = 0;
+      saveData(_asyncValue, _asyncTime);
+    }
+  }
+}
+
+template <class BUS> void MD_HX711B<BUS>::readNB(void)
+// NON-Blocking read the data from the HX711 in an IRQ safe manner.
+{
+  uint8_t extras;
+  int32_t value;
+  uint32_t time = _timeSource();   // DAT is low now
+
+  _inISR = true;
+
+  // set the next read channel and mode
+  extras = nextReadMode();
+
+  // do the read
+  if (_shortMask)
+  {
+#if !HX711_ISR_ARG && defined(__AVR__)
+    // AVR ISRs run with interrupts disabled. Enabling them during the read 
+    // would retrigger this (level triggered) ISR when DAT is low, so it 
+    // is detached for the duration of the read.
+    bool inIRQ = isInterruptMode();
+
+    if (inIRQ) detachInterrupt(digitalPinToInterrupt(_bus.pinDat()));
+    value = HX711ReadData(extras);
+    if (inIRQ) attachInterrupt(digitalPinToInterrupt(_bus.pinDat()), _myISR, ISR_TRIGGER);
+#else
+    value = HX711ReadData(extras);
+#endif
+  }
+  else
+  {
+    noInterrupts();
+    value = HX711ReadData(extras);
+    interrupts();
+  }
+
+  saveData(value, time);
+
+  _inISR = false;
+}
+
+template <class BUS> void MD_HX711B<BUS>::service(void)
+// Read the data if polled and pass new data to the deferred callback
+{
+  if (!isInterruptMode() && !_async && isReady())
+    readNB();
+
+  serviceCallback();
+}
+
+/**
+ * Core object for the MD_HX711 library
+ *
+ * The CLK and DAT pins are set at run time and accessed using the standard
+ * digitalWrite() and digitalRead() functions (MD_HX711_PinBus).
+ */
+class MD_HX711 : public MD_HX711B<MD_HX711_PinBus>
+{
+public:
+  /**
+   * Class Constructor
+   *
+   * Instantiate a new instance of the class.
+   *
+   * The main function for the core object is to set the internal
+   * shared variables to default or passed values.
+   *
+   * \param pinClk pin used for SCK/CLK signal.
+   * \param pinDat pin used for DAT/SD signal.
+   */
+  MD_HX711(uint8_t pinClk, uint8_t pinDat) : MD_HX711B<MD_HX711_PinBus>(MD_HX711_PinBus(pinClk, pinDat)) {}
+};
+
+/**
+ * Compile-time pin variant of the MD_HX711 object.
+ * 
+ * This template class behaves identically to MD_HX711 but the CLK and DAT pins 
+ * are template parameters. This allows the pins to be manipulated directly 
+ * through the processor port registers rather than the generic digitalWrite() 
+ * and digitalRead() functions, substantially reducing the time taken (and time 
+ * interrupts are disabled) when reading data from the HX711.
+ * 
+ * The bit stream clocked to/from the HX711 is the same as for MD_HX711.
+ * 
+ * \tparam PIN_CLK pin used for SCK/CLK signal.
+ * \tparam PIN_DAT pin used for DAT/SD signal.
+ */
+template <uint8_t PIN_CLK, uint8_t PIN_DAT> class MD_HX711T : public MD_HX711B<MD_HX711_FastBus<PIN_CLK, PIN_DAT> >
+{
+public:
+  /**
+   * Class Constructor
+   *
+   * Instantiate a new instance of the class.
+   */
+  MD_HX711T(void) {}
+};
+
+/**
+ * Parallel read of multiple HX711 devices sharing the same CLK pin.
+ * 
+ * All the devices in the array are connected to the same CLK pin and each
+ * has its own DAT pin. The shared CLK is driven once for a read cycle and
+ * all the DAT lines are sampled on each clock edge, so that the data for
+ * every device is received at the same time.
+ * 
+ * The array keeps only the raw data and tare for each device, accessed 
+ * by the device index (0 to N-1). Filtering and calibration are left to 
+ * the application, which will often combine the cells before scaling 
+ * (eg, the sum of the tared values for a platform scale). The channel and 
+ * gain selection applies to all devices.
+ * 
+ * As all DAT lines are sampled while CLK is high, the number of devices
+ * should be limited so that this time remains below the 60us HX711 power 
+ * down threshold.
+ * 
+ * \tparam N the number of devices in the array.
+ */
+template <uint8_t N> class MD_HX711Array
+{
+public:
+  /**
+   * Class Constructor
+   *
+   * Instantiate a new instance of the class.
+   * 
+   * \param pinClk pin used for the shared SCK/CLK signal.
+   * \param pinDat array of N pins used for the DAT/SD signal of each device.
+   */
+  MD_HX711Array(uint8_t pinClk, const uint8_t pinDat[N]) : _pinClk(pinClk)
+  {
+    for (uint8_t i = 0; i < N; i++)
+      _cell[i].pinDat = pinDat[i];
+  }
+
+  /**
+   * Initialize the object.
+   *
+   * Initialize the pins and reset all the devices in the array. This needs 
+   * to be called during setup().
+   *
+   * \sa reset()
+   */
+  void begin(void)
+  {
+    pinMode(_pinClk, OUTPUT);
+    for (uint8_t i = 0; i < N; i++)
+      pinMode(_cell[i].pinDat, INPUT);
+
+    reset();
+  }
+
+  /**
+   * Reset the HX711 hardware and library defaults.
+   *
+   * Power cycle all the devices and clear the data and tare for each device.
+   * 
+   * \sa MD_HX711::reset()
+   */
+  void reset(void)
+  {
+    clkHigh();
+    delayMicroseconds(64);    // power down, CLK high for at least 60us
+    clkLow();
+
+    _enableB = false;
+    _mode = MD_HX711::GAIN_128;
+    _shortMask = false;
+    _nextReadA = true;
+    _lastExtras = 1;          // hardware reset default is A128
+    _readCounter = 0;
+    _time = 0;
+    for (uint8_t i = 0; i < N; i++)
+      for (uint8_t ch = 0; ch < NUM_CHAN; ch++)
+        _cell[i].raw[ch] = _cell[i].tare[ch] = 0;
+  }
+
+  /**
+   * Enable Channel B read cycle for all devices.
+   *
+   * \sa MD_HX711::enableChannelB()
+   *
+   * \param ena set true to enable reads, false to disable.
+   */
+  inline void enableChannelB(bool ena = true) { _enableB = ena; }
+
+  /**
+   * Limit the time interrupts are disabled during a read for all devices.
+   *
+   * \sa MD_HX711::enableShortIRQMask()
+   *
+   * \param ena set true to enable, false to disable.
+   */
+  inline void enableShortIRQMask(bool ena = true) { _shortMask = ena; }
+
+  /**
+   * Set Channel A gain for all devices.
+   *
+   * \sa MD_HX711::setGainA()
+   *
+   * \param mode set to one of the mode_t values.
+   */
+  inline void setGainA(MD_HX711::mode_t mode) { _mode = mode; }
+
+  /**
+   * Return status of data ready at all HX711 devices
+   *
+   * \return true if data is ready at all the HX711 devices.
+   */
+  bool isReady(void)
+  {
+    for (uint8_t i = 0; i < N; i++)
+      if (datHigh(i)) return(false);
+
+    return(true);
+  }
+
+  /**
+   * Read next data from all the HX711 devices.
+   *
+   * Wait for the data to be ready at all devices and then read the data 
+   * for each device, accessed through getRaw() and getTared().
+   *
+   * \sa isReady(), MD_HX711::read()
+   *
+   * \return an indicator of which channel was read
+   */
+  MD_HX711::channel_t read(void)
+  {
+    int32_t value[N];
+    uint8_t extras;
+    MD_HX711::channel_t ch = (_lastExtras == 2) ? MD_HX711::CH_B : MD_HX711::CH_A;
+
+    // blocking wait to make sure we have data to read
+    while (!isReady()) { yield(); }
+    _time = micros();
+
+    // the conversion being read was set up by the last read
+    _nextReadA = _enableB ? !_nextReadA : true;
+    extras = MD_HX711Base::modeExtras(_nextReadA, _mode);
+    _lastExtras = extras;
+
+    if (!_shortMask) noInterrupts();
+    MD_HX711Base::HX711Shift<N>(*this, value, extras, _shortMask);
+    if (!_shortMask) interrupts();
+
+    // sign extend and save the data for each device
+    for (uint8_t i = 0; i < N; i++)
+    {
+      if (value[i] & 0x800000) value[i] |= 0xff000000;
+      _cell[i].raw[ch] = value[i];
+    }
+    _readCounter++;
+
+    return(ch);
+  }
+
+  /**
+   * Get the last raw data for a device.
+   *
+   * \param i  the device index, 0 to N-1.
+   * \param ch the channel to retrieve. Default CH_A.
+   * \return the last raw data received from the HX711 for the specified channel.
+   */
+  inline int32_t getRaw(uint8_t i, MD_HX711::channel_t ch = MD_HX711::CH_A) { return(_cell[i].raw[ch]); }
+
+  /**
+   * Get the last raw data for a device, adjusted by its tare.
+   *
+   * \param i  the device index, 0 to N-1.
+   * \param ch the channel to retrieve. Default CH_A.
+   * \return the raw data less the tare value for the specified channel.
+   */
+  inline int32_t getTared(uint8_t i, MD_HX711::channel_t ch = MD_HX711::CH_A) { return(_cell[i].raw[ch] - _cell[i].tare[ch]); }
+
+  /**
+   * Set the tare value for a device.
+   *
+   * \sa getZeroTare(), autoZeroTare()
+   *
+   * \param i    the device index, 0 to N-1.
+   * \param tare the raw value that represents zero load.
+   * \param ch   the channel to set. Default CH_A.
+   */
+  inline void setZeroTare(uint8_t i, int32_t tare, MD_HX711::channel_t ch = MD_HX711::CH_A) { _cell[i].tare[ch] = tare; }
+
+  /**
+   * Get the tare value for a device.
+   *
+   * \sa setZeroTare(), autoZeroTare()
+   *
+   * \param i  the device index, 0 to N-1.
+   * \param ch the channel to retrieve. Default CH_A.
+   * \return the tare value for the specified channel.
+   */
+  inline int32_t getZeroTare(uint8_t i, MD_HX711::channel_t ch = MD_HX711::CH_A) { return(_cell[i].tare[ch]); }
+
+  /**
+   * Set the tare for all devices from the current readings.
+   *
+   * Blocking read of the specified number of samples for each enabled 
+   * channel. The average of the samples becomes the tare for each device.
+   * The tares are accumulated in place, so samples is limited to 127.
+   *
+   * \sa setZeroTare(), getZeroTare()
+   *
+   * \param samples the number of samples to average for each channel. Default TARE_SAMPLES.
+   */
+  void autoZeroTare(uint8_t samples = MD_HX711::TARE_SAMPLES)
+  {
+    uint8_t numCh = _enableB ? NUM_CHAN : 1;
+
+    if (samples == 0) samples = 1;
+    if (samples > 127) samples = 127;   // 24 bit data sum fits in 31 bits
+    for (uint8_t i = 0; i < N; i++)
+      for (uint8_t ch = 0; ch < NUM_CHAN; ch++)
+        _cell[i].tare[ch] = 0;
+
+    for (uint16_t j = 0; j < (uint16_t)samples * numCh; j++)
+    {
+      MD_HX711::channel_t ch = read();
+
+      for (uint8_t i = 0; i < N; i++)
+        _cell[i].tare[ch] += _cell[i].raw[ch];
+    }
+
+    for (uint8_t i = 0; i < N; i++)
+      for (uint8_t ch = 0; ch < numCh; ch++)
+        _cell[i].tare[ch] /= samples;
+  }
+
+  /**
+   * Get the timestamp of the last read.
+   *
+   * \return the micros() time of the last read.
+   */
+  inline uint32_t getTimestamp(void) { return(_time); }
+
+  /**
+   * Get the number of reads since the last reset.
+   *
+   * \return the read counter.
+   */
+  inline uint32_t getReadCount(void) { return(_readCounter); }
+
+private:
+  static const uint8_t NUM_CHAN = 2;
+
+  typedef struct
+  {
+    uint8_t pinDat;       ///< DAT pin for this device
+    int32_t raw[NUM_CHAN];  ///< raw data for Channels A/B
+    int32_t tare[NUM_CHAN]; ///< tare offset for Channels A/B
+  } cell_t;
+
+  uint8_t _pinClk;        ///< shared CLK pin
+  bool    _enableB;       ///< channel B read enabled when true
+  MD_HX711::mode_t _mode; ///< channel A current mode
+  bool    _nextReadA;     ///< if true read channel A next
+  bool    _shortMask;     ///< disable interrupts only while CLK is high during a read
+  uint8_t _lastExtras;    ///< extra clock pulses sent on the last read
+  uint32_t _readCounter;  ///< count the number of reads
+  uint32_t _time;         ///< timestamp of the last read
+  cell_t  _cell[N];       ///< the devices in the array
+
+  // HX711Shift() I/O interface for the shared CLK and DAT line of each device
+  inline void clkHigh(void) { digitalWrite(_pinClk, HIGH); }
+  inline void clkLow(void)  { digitalWrite(_pinClk, LOW); }
+  inline bool datHigh(uint8_t i) { return(digitalRead(_cell[i].pinDat) == HIGH); }
+
+  friend class MD_HX711Base;
 };
@@ -0,0 +1,320 @@
+#include <MD_HX711_Cal.h>
+
+/**
+ * \file
+ * \brief Code file for the MD_HX711 calibration curve classes.
+ */
+
+static int32_t limit32(int64_t v)
+// Limit v to the int32_t range, excluding CALIB_INVALID
+{
+  if (v > 0x7fffffffL) return(0x7fffffffL);
+  if (v < -0x7fffffffL) return(-0x7fffffffL);
+  return((int32_t)v);
+}
+
+bool MD_HX711_CalTable::addPoint(int32_t raw, int32_t value)
+// Add the point and work out the slope of the segment ending at this point
+{
+  if (_count >= _size) return(false);
+  if (_count != 0 && raw <= _pts[_count - 1].raw) return(false);
+
+  point_t *p = &_pts[_count];
+
+  p->raw = raw;
+  p->value = value;
+  p->mult = 0;
+  p->shift = 0;
+
+  if (_count != 0)
+  {
+    point_t *pp = &_pts[_count - 1];
+    int64_t dy = (int64_t)value - pp->value;
+    uint32_t dx = (uint32_t)(raw - pp->raw);
+
+    // slope = dy / dx as mult * 2^-shift, with as many bits as possible in mult
+    if (dy != 0)
+    {
+      int8_t k = 0;
+
+      while (dy < ((int64_t)1 << 61) && dy > -((int64_t)1 << 61))
+      {
+        dy *= 2;
+        k++;
+      }
+      dy /= dx;
+      while (dy >= (int64_t)0x7fffffffL || dy <= -(int64_t)0x7fffffffL)
+      {
+        dy = (dy + 1) >> 1;
+        k--;
+      }
+      pp->mult = (int32_t)dy;
+      pp->shift = k;
+    }
+
+    // keep track of whether the spacing is uniform
+    if (_count == 1)
+      _step = dx;
+    else if (dx != _step)
+      _step = 0;
+    _inv = (_step > 1) ? (uint32_t)(0xffffffffUL / _step) : 0;
+  }
+  _count++;
+
+  return(true);
+}
+
+bool MD_HX711_CalTable::getPoint(uint8_t idx, int32_t &raw, int32_t &value)
+{
+  if (idx >= _count) return(false);
+
+  raw = _pts[idx].raw;
+  value = _pts[idx].value;
+
+  return(true);
+}
+
+uint16_t MD_HX711_CalTable::save(uint8_t *blob, uint16_t size)
+// Save the points as little endian bytes, raw then value
+{
+  uint16_t n = getBlobSize();
+
+  if (size < n) return(0);
+
+  *blob++ = _count;
+  for (uint8_t i = 0; i < _count; i++)
+  {
+    uint32_t r = (uint32_t)_pts[i].raw;
+    uint32_t v = (uint32_t)_pts[i].value;
+
+    for (uint8_t j = 0; j < 4; j++)
+    {
+      blob[j] = r & 0xff;
+      blob[j + 4] = v & 0xff;
+      r >>= 8;
+      v >>= 8;
+    }
+    blob += BLOB_POINT;
+  }
+
+  return(n);
+}
+
+bool MD_HX711_CalTable::load(const uint8_t *blob, uint16_t size)
+// Load the points from the blob, rebuilding the table slopes
+{
+  if (size < 1) return(false);
+
+  uint8_t count = *blob++;
+
+  if (count > _size || size < 1 + (uint16_t)count * BLOB_POINT) return(false);
+
+  clear();
+  for (uint8_t i = 0; i < count; i++)
+  {
+    uint32_t r = 0, v = 0;
+
+    for (int8_t j = 3; j >= 0; j--)
+    {
+      r = (r << 8) | blob[j];
+      v = (v << 8) | blob[j + 4];
+    }
+    blob += BLOB_POINT;
+
+    if (!addPoint((int32_t)r, (int32_t)v))
+    {
+      clear();
+      return(false);
+    }
+  }
+
+  return(true);
+}
+
+int32_t MD_HX711_CalTable::calibrate(int32_t tared)
+// Find the segment for the tared value and interpolate
+{
+  if (_count < 2) return(MD_HX711::CALIB_INVALID);
+
+  uint8_t last = _count - 2;  // last segment
+  uint8_t i;
+
+  if (tared <= _pts[0].raw)
+    i = 0;
+  else if (tared >= _pts[last + 1].raw)
+    i = last;
+  else if (_step != 0)
+  {
+    // uniform spacing, work out the segment directly
+    uint32_t d = (uint32_t)(tared - _pts[0].raw);
+    uint32_t idx = (_step == 1) ? d : (uint32_t)(((uint64_t)d * _inv) >> 32);
+
+    i = (idx > last) ? last : idx;
+    while (i < last && tared >= _pts[i + 1].raw)   // _inv may round down by 1
+      i++;
+  }
+  else
+  {
+    // binary search for the segment
+    uint8_t lo = 0, hi = last + 1;
+
+    while (hi - lo > 1)
+    {
+      uint8_t mid = (lo + hi) / 2;
+
+      if (tared < _pts[mid].raw)
+        hi = mid;
+      else
+        lo = mid;
+    }
+    i = lo;
+  }
+
+  // interpolate, rounding the slope product to nearest
+  point_t *p = &_pts[i];
+  int64_t v = ((int64_t)tared - p->raw) * p->mult;
+  bool neg = (v < 0);
+  uint64_t u = neg ? -(uint64_t)v : (uint64_t)v;
+
+  if (p->shift > 0) u = (u + ((uint64_t)1 << (p->shift - 1))) >> p->shift;
+  else u <<= -p->shift;    // only for very steep segments
+  v = neg ? -(int64_t)u : (int64_t)u;
+
+  return(limit32(p->value + v));
+}
+
+bool MD_HX711_CalPoly::set(uint8_t order, const int32_t *coeff, uint8_t xShift, int32_t ySpan)
+{
+  if (order == 0 || order > MAX_ORDER || xShift > 31) return(false);
+
+  for (uint8_t k = 0; k <= MAX_ORDER; k++)
+    _coeff[k] = (k <= order) ? coeff[k] : 0;
+  _xShift = xShift;
+  _ySpan = ySpan;
+  _order = order;
+
+  return(true);
+}
+
+bool MD_HX711_CalPoly::fit(const int32_t *raw, const int32_t *value, uint8_t count, uint8_t order)
+// Least squares fit by solving the normal equations with Gaussian 
+// elimination. The points are normalized first to keep the 
+// equations well conditioned.
+{
+  const uint8_t n = order + 1;
+  double a[MAX_ORDER + 1][MAX_ORDER + 2];   // augmented matrix
+  int32_t c[MAX_ORDER + 1];
+  uint8_t xShift = 0;
+  double ySpan = 1;
+
+  if (order == 0 || order > MAX_ORDER || count <= order) return(false);
+
+  // normalization so that u and y are within +/-1
+  for (uint8_t i = 0; i < count; i++)
+  {
+    uint32_t x = (raw[i] < 0) ? -(uint32_t)raw[i] : (uint32_t)raw[i];
+
+    while (xShift < 31 && x > ((uint32_t)1 << xShift)) xShift++;
+    if (fabs((double)value[i]) > ySpan) ySpan = fabs((double)value[i]);
+  }
+
+  // build the normal equations
+  for (uint8_t j = 0; j < n; j++)
+    for (uint8_t k = 0; k <= n; k++)
+      a[j][k] = 0;
+
+  for (uint8_t i = 0; i < count; i++)
+  {
+    double u = ldexp((double)raw[i], -xShift);
+    double y = value[i] / ySpan;
+    double uj = 1;
+
+    for (uint8_t j = 0; j < n; j++)
+    {
+      double ujk = uj;
+
+      for (uint8_t k = 0; k < n; k++)
+      {
+        a[j][k] += ujk;
+        ujk *= u;
+      }
+      a[j][n] += y * uj;
+      uj *= u;
+    }
+  }
+
+  // solve with partial pivoting
+  for (uint8_t j = 0; j < n; j++)
+  {
+    uint8_t p = j;
+
+    for (uint8_t i = j + 1; i < n; i++)
+      if (fabs(a[i][j]) > fabs(a[p][j])) p = i;
+    if (fabs(a[p][j]) < 1e-12) return(false);   // singular, eg repeated raw values
+
+    if (p != j)
+    {
+      for (uint8_t k = 0; k <= n; k++)
+      {
+        double t = a[j][k];
+        a[j][k] = a[p][k];
+        a[p][k] = t;
+      }
+    }
+
+    for (uint8_t i = 0; i < n; i++)
+    {
+      if (i == j) continue;
+
+      double f = a[i][j] / a[j][j];
+
+      for (uint8_t k = j; k <= n; k++)
+        a[i][k] -= f * a[j][k];
+    }
+  }
+
+  // scale the span so that all the coefficients are within +/-4
+  double cMax = 0;
+
+  for (uint8_t j = 0; j < n; j++)
+  {
+    a[j][n] /= a[j][j];
+    if (fabs(a[j][n]) > cMax) cMax = fabs(a[j][n]);
+  }
+  if (cMax > 4)
+    ySpan *= cMax / 4;
+  else
+    cMax = 4;
+  if (ySpan > 2147483647.0) return(false);
+
+  for (uint8_t j = 0; j < n; j++)
+    c[j] = (int32_t)floor(ldexp(a[j][n] * 4 / cMax, 28) + 0.5);
+
+  return(set(order, c, xShift, (int32_t)ceil(ySpan)));
+}
+
+int32_t MD_HX711_CalPoly::calibrate(int32_t tared)
+// Evaluate the polynomial using Horner's method in Q4.28, with the 
+// sum limited to +/-16 so that the products fit in 64 bits.
+{
+  const int64_t LIMIT = (int64_t)1 << 32;
+
+  if (_order == 0) return(MD_HX711::CALIB_INVALID);
+
+  // u in Q4.28, limited to +/-4
+  int64_t u = (_xShift <= 28) ? (int64_t)tared * ((int64_t)1 << (28 - _xShift)) : (int64_t)tared >> (_xShift - 28);
+
+  if (u > ((int64_t)1 << 30)) u = (int64_t)1 << 30;
+  if (u < -((int64_t)1 << 30)) u = -((int64_t)1 << 30);
+
+  int64_t s = _coeff[_order];
+
+  for (int8_t k = _order - 1; k >= 0; k--)
+  {
+    s = ((s * u + ((int64_t)1 << 27)) >> 28) + _coeff[k];
+    if (s > LIMIT) s = LIMIT;
+    if (s < -LIMIT) s = -LIMIT;
+  }
+
+  return(limit32((s * _ySpan + ((int64_t)1 << 27)) >> 28));
+}
@@ -0,0 +1,267 @@
+#pragma once
+
+#include "MD_HX711.h"
+
+/**
+ * \file
+ * \brief Header file for the MD_HX711 calibration curve classes.
+ */
+
+/**
+ * Calibration curve base class.
+ *
+ * A calibration curve converts tared ADC values into calibrated values,
+ * replacing the single point linear calibration set by setCalibration().
+ * It is used for load cells that are not linear over their full range.
+ * A curve is attached to a channel using MD_HX711::setCalCurve(), and is
+ * then used by all the calibrated data methods.
+ *
+ * The calibrated values are integers in units chosen by the application
+ * (eg, grams or milligrams).
+ */
+class MD_HX711_Cal
+{
+public:
+  virtual ~MD_HX711_Cal(void) {}
+
+  /**
+   * Convert a tared value.
+   *
+   * \param tared the tared ADC value.
+   * \return the calibrated value, or MD_HX711::CALIB_INVALID if the curve is not set up.
+   */
+  virtual int32_t calibrate(int32_t tared) = 0;
+};
+
+/**
+ * Piecewise linear calibration table.
+ *
+ * The table holds a number of (raw, value) points, where raw is the tared
+ * ADC value and value is the calibrated value for that reading. Tared values
+ * between points are interpolated along the line joining them, and values
+ * outside the table use the first or last segment.
+ *
+ * The slope of each segment is worked out when the point is added, as a
+ * fixed point multiplier and shift, so each conversion is a search for the
+ * segment and one multiplication. If the points are evenly spaced, the
+ * segment is found directly from the raw value. Otherwise a binary search
+ * is used.
+ *
+ * The point storage is allocated by the application and must remain valid
+ * while it is in use.
+ *
+ *     MD_HX711_CalTable::point_t calPoints[5];
+ *     MD_HX711_CalTable calTable(calPoints, 5);
+ *
+ *     calTable.addPoint(0, 0);
+ *     calTable.addPoint(210345, 1000);
+ *     ...
+ *     scale.setCalCurve(&calTable);
+ *
+ * The table points can be saved to and loaded from a compact binary blob
+ * (eg, for storage in EEPROM) with save() and load(). The blob is one byte
+ * holding the number of points followed by BLOB_POINT bytes for each point.
+ */
+class MD_HX711_CalTable : public MD_HX711_Cal
+{
+public:
+  /**
+   * Table point storage.
+   */
+  typedef struct
+  {
+    int32_t raw;    ///< tared ADC value
+    int32_t value;  ///< calibrated value for raw
+    int32_t mult;   ///< slope to the next point, multiplier
+    int8_t  shift;  ///< slope to the next point, binary shift
+  } point_t;
+
+  static const uint8_t BLOB_POINT = 8;  ///< Bytes for each point in the blob
+
+  /**
+   * Class Constructor
+   *
+   * \param pts  pointer to the point storage.
+   * \param size the number of point_t elements in pts.
+   */
+  MD_HX711_CalTable(point_t *pts, uint8_t size) : _pts(pts), _size(size) { clear(); }
+
+  /**
+   * Remove all the points from the table.
+   */
+  void clear(void) { _count = 0; _step = 0; }
+
+  /**
+   * Add a point to the table.
+   *
+   * Points must be added in increasing order of raw value.
+   *
+   * \param raw   the tared ADC value.
+   * \param value the calibrated value for raw.
+   * \return true if the point was added, false if the table is full or raw is out of order.
+   */
+  bool addPoint(int32_t raw, int32_t value);
+
+  /**
+   * Get the number of points in the table.
+   *
+   * \return the number of points.
+   */
+  inline uint8_t getCount(void) { return(_count); }
+
+  /**
+   * Get a table point.
+   *
+   * \param idx   the index of the point, 0 to getCount()-1.
+   * \param raw   receives the tared ADC value.
+   * \param value receives the calibrated value.
+   * \return true if the point exists.
+   */
+  bool getPoint(uint8_t idx, int32_t &raw, int32_t &value);
+
+  /**
+   * Check if the points are evenly spaced.
+   *
+   * \return true if the segment is found directly, false if a binary search is used.
+   */
+  inline bool isUniform(void) { return(_step != 0); }
+
+  /**
+   * Get the size of the blob for the current table.
+   *
+   * \return the number of bytes needed by save().
+   */
+  inline uint16_t getBlobSize(void) { return(1 + (uint16_t)_count * BLOB_POINT); }
+
+  /**
+   * Save the table points to a blob.
+   *
+   * \param blob pointer to the blob memory.
+   * \param size the size of the blob memory in bytes.
+   * \return the number of bytes used, 0 if the blob is too small.
+   */
+  uint16_t save(uint8_t *blob, uint16_t size);
+
+  /**
+   * Load the table points from a blob.
+   *
+   * The current table contents are replaced by the points in the blob.
+   *
+   * \param blob pointer to the blob memory.
+   * \param size the size of the blob memory in bytes.
+   * \return true if the blob was loaded, false if it is not valid for this table.
+   */
+  bool load(const uint8_t *blob, uint16_t size);
+
+  // MD_HX711_Cal interface
+  virtual int32_t calibrate(int32_t tared);
+
+private:
+  point_t *_pts;    ///< point storage
+  uint8_t _size;    ///< number of elements in _pts
+  uint8_t _count;   ///< number of points in the table
+  uint32_t _step;   ///< raw value spacing when uniform, 0 otherwise
+  uint32_t _inv;    ///< 2^32/_step for direct segment indexing
+};
+
+/**
+ * Polynomial calibration curve.
+ *
+ * The calibrated value is a polynomial of order 1 to MAX_ORDER in the tared
+ * value, used to correct the non-linearity of a load cell. The polynomial is
+ * evaluated in fixed point using Horner's method, with one 64 bit multiply
+ * for each order.
+ *
+ * The tared value is normalized to u = tared / 2^xShift, so that u is within
+ * +/-1 over the calibrated range, and the calibrated value is
+ *
+ *     value = ySpan * (a0 + a1*u + a2*u^2 + ... + an*u^n)
+ *
+ * where the coefficients a0..an are Q4.28 fixed point numbers (the real
+ * coefficient multiplied by 2^28) no larger than +/-4.
+ *
+ * The coefficients are normally worked out by fit(), a least squares fit of
+ * the polynomial to recorded calibration points. fit() uses floating point
+ * arithmetic and may be run on a host computer. The results are read using
+ * getCoeff(), getXShift() and getYSpan() and loaded into the application
+ * using set().
+ *
+ *     MD_HX711_CalPoly poly;
+ *
+ *     poly.fit(raw, value, count, 3);
+ *     scale.setCalCurve(&poly);
+ */
+class MD_HX711_CalPoly : public MD_HX711_Cal
+{
+public:
+  static const uint8_t MAX_ORDER = 4;   ///< Highest polynomial order
+
+  /**
+   * Class Constructor
+   */
+  MD_HX711_CalPoly(void) : _order(0), _xShift(0), _ySpan(0) {}
+
+  /**
+   * Set the polynomial.
+   *
+   * \param order  the order of the polynomial, 1 to MAX_ORDER.
+   * \param coeff  array of order+1 Q4.28 coefficients, a0 first.
+   * \param xShift the tared value normalization shift.
+   * \param ySpan  the calibrated value multiplier.
+   * \return true if the polynomial was set, false if the parameters are not valid.
+   */
+  bool set(uint8_t order, const int32_t *coeff, uint8_t xShift, int32_t ySpan);
+
+  /**
+   * Fit the polynomial to calibration points.
+   *
+   * Work out the coefficients that give the least squares error for the
+   * calibration points, using floating point arithmetic. There must be more
+   * points than the order of the polynomial.
+   *
+   * \param raw   array of tared values.
+   * \param value array of calibrated values for each raw.
+   * \param count the number of points.
+   * \param order the order of the polynomial, 1 to MAX_ORDER.
+   * \return true if the fit was successful and the polynomial set.
+   */
+  bool fit(const int32_t *raw, const int32_t *value, uint8_t count, uint8_t order);
+
+  /**
+   * Get the polynomial order.
+   *
+   * \return the polynomial order, 0 if not set.
+   */
+  inline uint8_t getOrder(void) { return(_order); }
+
+  /**
+   * Get a polynomial coefficient.
+   *
+   * \param k the coefficient index, 0 to getOrder().
+   * \return the Q4.28 coefficient for u^k.
+   */
+  inline int32_t getCoeff(uint8_t k) { return(k <= MAX_ORDER ? _coeff[k] : 0); }
+
+  /**
+   * Get the tared value normalization shift.
+   *
+   * \return the xShift value.
+   */
+  inline uint8_t getXShift(void) { return(_xShift); }
+
+  /**
+   * Get the calibrated value multiplier.
+   *
+   * \return the ySpan value.
+   */
+  inline int32_t getYSpan(void) { return(_ySpan); }
+
+  // MD_HX711_Cal interface
+  virtual int32_t calibrate(int32_t tared);
+
+private:
+  uint8_t _order;                   ///< polynomial order, 0 if not set
+  uint8_t _xShift;                  ///< tared value normalization shift
+  int32_t _ySpan;                   ///< calibrated value multiplier
+  int32_t _coeff[MAX_ORDER + 1];    ///< Q4.28 coefficients, a0 first
+};
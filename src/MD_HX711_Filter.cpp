@@ -0,0 +1,534 @@
+#include <MD_HX711_Filter.h>
+
+/**
+ * \file
+ * \brief Code file for the MD_HX711 data filter classes.
+ */
+
+MD_HX711_FilterAvg::MD_HX711_FilterAvg(int32_t *buf, uint8_t size) : _buf(buf)
+{
+  if (size > MAX_SIZE) size = MAX_SIZE;
+  if (size == 0) size = 1;
+
+  _shift = 0;
+  while ((2 << _shift) <= size)
+    _shift++;
+  _mask = (1 << _shift) - 1;
+
+  reset();
+}
+
+int32_t MD_HX711_FilterAvg::apply(int32_t value, uint32_t)
+// Replace the oldest sample in the running sum with the new one.
+// 128 x 24 bit samples fit in the 32 bit sum.
+{
+  if (!_valid)
+  {
+    for (uint8_t i = 0; i <= _mask; i++)
+      _buf[i] = value;
+    _sum = value * (int32_t)(_mask + 1);
+    _idx = 0;
+    _valid = true;
+  }
+  else
+  {
+    _sum += value - _buf[_idx];
+    _buf[_idx] = value;
+    _idx = (_idx + 1) & _mask;
+  }
+
+  return((_sum + ((1L << _shift) >> 1)) >> _shift);
+}
+
+MD_HX711_FilterMedian::MD_HX711_FilterMedian(uint8_t size, int32_t limit) : _limit(limit), _rejected(0)
+{
+  if (size > MAX_SIZE) size = MAX_SIZE;
+  if (size < 3) size = 3;
+  _size = size | 1;     // must be odd
+
+  reset();
+}
+
+int32_t MD_HX711_FilterMedian::apply(int32_t value, uint32_t)
+// Remove the oldest sample from the sorted list and insert the new one
+{
+  uint8_t i;
+
+  if (!_valid)
+  {
+    for (i = 0; i < _size; i++)
+      _hist[i] = _sorted[i] = value;
+    _idx = 0;
+    _valid = true;
+  }
+  else
+  {
+    int32_t old = _hist[_idx];
+
+    _hist[_idx] = value;
+    if (++_idx >= _size) _idx = 0;
+
+    // find the old sample
+    for (i = 0; _sorted[i] != old; i++)
+      ;
+
+    // move the hole to where the new sample goes
+    while (i > 0 && _sorted[i - 1] > value)
+    {
+      _sorted[i] = _sorted[i - 1];
+      i--;
+    }
+    while (i < _size - 1 && _sorted[i + 1] < value)
+    {
+      _sorted[i] = _sorted[i + 1];
+      i++;
+    }
+    _sorted[i] = value;
+  }
+
+  int32_t median = _sorted[_size / 2];
+
+  if (_limit != 0 && (value - median > _limit || median - value > _limit))
+    _rejected++;
+
+  return(median);
+}
+
+int32_t MD_HX711_FilterEMA::apply(int32_t value, uint32_t)
+// Running average with _shift fraction bits.
+// 24 bit data with up to 7 fraction bits fits in 32 bits.
+{
+  if (!_valid)
+  {
+    _acc = value * (1L << _shift);
+    _valid = true;
+  }
+  else
+    _acc += value - ((_acc + ((1L << _shift) >> 1)) >> _shift);
+
+  return((_acc + ((1L << _shift) >> 1)) >> _shift);
+}
+
+MD_HX711_FilterBiquad::MD_HX711_FilterBiquad(void)
+{
+  setCoeff(1L << COEFF_BITS, 0, 0, 0, 0);
+}
+
+void MD_HX711_FilterBiquad::setCoeff(int32_t b0, int32_t b1, int32_t b2, int32_t a1, int32_t a2)
+{
+  loadCoeff(b0, b1, b2, a1, a2);
+  reset();
+}
+
+void MD_HX711_FilterBiquad::loadCoeff(int32_t b0, int32_t b1, int32_t b2, int32_t a1, int32_t a2)
+{
+  _b0 = b0;
+  _b1 = b1;
+  _b2 = b2;
+  _a1 = a1;
+  _a2 = a2;
+}
+
+void MD_HX711_FilterBiquad::setCoeffF(float b0, float b1, float b2, float a1, float a2)
+// Convert the coefficients to fixed point, rounded to nearest
+{
+  const float SCALE = (float)(1L << COEFF_BITS);
+
+  setCoeff((int32_t)lround(b0 * SCALE), (int32_t)lround(b1 * SCALE), (int32_t)lround(b2 * SCALE),
+           (int32_t)lround(a1 * SCALE), (int32_t)lround(a2 * SCALE));
+}
+
+bool MD_HX711_FilterBiquad::setLowPass(float fc, float fs)
+// Bilinear transform of the analog Butterworth prototype
+{
+  if (fc <= 0.0 || fs <= 2 * fc) return(false);
+
+  float k = tan(M_PI * fc / fs);
+  float k2 = k * k;
+  float norm = 1.0 / (1.0 + M_SQRT2 * k + k2);
+
+  setCoeffF(k2 * norm, 2 * k2 * norm, k2 * norm, 2 * (k2 - 1) * norm, (1 - M_SQRT2 * k + k2) * norm);
+  _b1 = (1L << COEFF_BITS) + _a1 + _a2 - _b0 - _b2;   // exactly unity gain at DC after rounding
+
+  return(true);
+}
+
+int32_t MD_HX711_FilterBiquad::apply(int32_t value, uint32_t)
+// Direct form I, accumulated in Q(28+6). For coefficients up to 
+// +/-4 and 24 bit data the sum of products is less than 2^62.
+{
+  if (!_valid)
+  {
+    // start in the steady state for this value
+    _x1 = _x2 = value;
+    _y1 = _y2 = (int64_t)value * (1 << FRAC_BITS);
+    _err = 0;
+    _valid = true;
+  }
+
+  int64_t acc = ((int64_t)_b0 * value + (int64_t)_b1 * _x1 + (int64_t)_b2 * _x2) * (1 << FRAC_BITS);
+
+  acc -= (int64_t)_a1 * _y1 + (int64_t)_a2 * _y2;
+  acc += _err;    // error feedback, so there is no dead band at DC
+
+  int64_t y = (acc + ((int64_t)1 << (COEFF_BITS - 1))) >> COEFF_BITS;
+
+  _err = (int32_t)(acc - y * ((int64_t)1 << COEFF_BITS));
+
+  _x2 = _x1;
+  _x1 = value;
+  _y2 = _y1;
+  _y1 = y;
+
+  return((int32_t)((y + (1 << (FRAC_BITS - 1))) >> FRAC_BITS));
+}
+
+MD_HX711_FilterAdaptive::MD_HX711_FilterAdaptive(uint8_t minShift, uint8_t maxShift, int32_t threshold) :
+  _threshold(threshold)
+{
+  if (maxShift > MAX_SHIFT) maxShift = MAX_SHIFT;
+  if (minShift > maxShift) minShift = maxShift;
+  _minShift = minShift;
+  _maxShift = maxShift;
+
+  reset();
+}
+
+int32_t MD_HX711_FilterAdaptive::apply(int32_t value, uint32_t)
+// EMA with the shift reduced on a step and increased while stable.
+// The noise level is tracked as the average difference between 
+// consecutive samples, which a step changes only once. The state 
+// has FRAC_BITS fraction bits, so 24 bit data and differences fit 
+// in 32 bits.
+{
+  const uint8_t DEV_SHIFT = 4;    // smoothing for the deviation
+  const int32_t AUTO_MIN = 4;     // smallest automatic threshold
+  int32_t v = value * (1L << FRAC_BITS);
+
+  if (!_valid)
+  {
+    _acc = _last = v;
+    _dev = 0;
+    _shift = _minShift;
+    _count = 0;
+    _valid = true;
+  }
+  else
+  {
+    int32_t limit;
+    int32_t d = v - _acc;
+    int32_t ad = (d < 0) ? -d : d;
+
+    if (_threshold != 0)
+      limit = _threshold * (1L << FRAC_BITS);
+    else
+    {
+      // automatic threshold from the sample to sample noise
+      int32_t dv = v - _last;
+
+      if (dv < 0) dv = -dv;
+      limit = (_dev > (0x7fffffffL / 4)) ? 0x7fffffffL : 4 * _dev;
+      if (limit < (AUTO_MIN << FRAC_BITS)) limit = AUTO_MIN << FRAC_BITS;
+      if (dv > limit) dv = limit;     // limit the effect of a step on the noise level
+      _dev += (dv - _dev) >> DEV_SHIFT;
+    }
+    _last = v;
+
+    if (ad > limit)
+    {
+      // step change, respond quickly
+      _shift = _minShift;
+      _count = 0;
+    }
+    else if (_shift < _maxShift && ++_count >= (1 << _shift))
+    {
+      // increase smoothing after each time constant
+      _shift++;
+      _count = 0;
+    }
+    _acc += d >> _shift;
+  }
+
+  return((_acc + (1L << (FRAC_BITS - 1))) >> FRAC_BITS);
+}
+
+MD_HX711_FilterNotch::MD_HX711_FilterNotch(uint8_t mains, uint8_t radius, uint32_t period) :
+  _mains(mains), _radius(radius)
+{
+  _period = period << PERIOD_FRAC;
+  tune();
+  reset();
+}
+
+int32_t MD_HX711_FilterNotch::cosTurn(uint32_t phase)
+// Return cos(2*pi*phase/2^32) in Q28. The angle is reduced to 
+// 0..pi/4 using symmetry and the Taylor series (accurate to 
+// better than 1e-7) evaluated with Horner's method. The 
+// divisions by the series constants are multiplies by Q32 
+// reciprocals, so there are no divisions.
+{
+  const int64_t ONE = (int64_t)1 << 28;
+  bool neg = false, useSin = false;
+
+  if (phase & 0x80000000UL) phase = -phase;                  // cos(-x) = cos(x)
+  if (phase > 0x40000000UL) { phase = 0x80000000UL - phase; neg = true; }    // cos(pi-x) = -cos(x)
+  if (phase > 0x20000000UL) { phase = 0x40000000UL - phase; useSin = true; } // cos(pi/2-x) = sin(x)
+
+  int64_t t = ((int64_t)phase * 1686629713LL) >> 32;   // angle in Q28 radians (2*pi in Q28)
+  int64_t t2 = (t * t) >> 28;
+  int64_t r;
+
+  if (useSin)
+  {
+    r = ONE - ((t2 * 59652324LL) >> 32);                       // 1/72
+    r = ONE - ((((t2 * r) >> 28) * 102261126LL) >> 32);        // 1/42
+    r = ONE - ((((t2 * r) >> 28) * 214748365LL) >> 32);        // 1/20
+    r = ONE - ((((t2 * r) >> 28) * 715827883LL) >> 32);        // 1/6
+    r = (t * r) >> 28;
+  }
+  else
+  {
+    r = ONE - ((t2 * 76695845LL) >> 32);                       // 1/56
+    r = ONE - ((((t2 * r) >> 28) * 143165577LL) >> 32);        // 1/30
+    r = ONE - ((((t2 * r) >> 28) * 357913941LL) >> 32);        // 1/12
+    r = ONE - (((t2 * r) >> 28) >> 1);                         // 1/2
+  }
+
+  return((int32_t)(neg ? -r : r));
+}
+
+void MD_HX711_FilterNotch::tune(void)
+// Work out the notch at the alias of the mains frequency for the 
+// current sample period, normalized for unity gain at DC.
+{
+  const int64_t ONE = (int64_t)1 << 28;
+  const uint32_t MIN_PHASE = 0x05000000UL;   // ~0.02 of the sample rate
+
+  _tuned = _period;
+
+  // mains frequency as turns per sample, the fraction is the alias
+  _phase = (uint32_t)((((uint64_t)_mains * _period) << (32 - PERIOD_FRAC)) / 1000000UL);
+
+  uint32_t folded = (_phase & 0x80000000UL) ? -_phase : _phase;
+
+  _bypass = (folded < MIN_PHASE);
+  if (_bypass) return;
+
+  int64_t c = cosTurn(_phase);
+  int64_t r = (int64_t)_radius << 20;     // Q8 to Q28
+  int64_t a1 = -((2 * r * c) >> 28);
+  int64_t a2 = (r * r) >> 28;
+  int64_t g = ((ONE + a1 + a2) << 28) / (2 * ONE - 2 * c);
+
+  loadCoeff((int32_t)g, (int32_t)(ONE + a1 + a2 - 2 * g), (int32_t)g, (int32_t)a1, (int32_t)a2);
+}
+
+uint16_t MD_HX711_FilterNotch::getNotchFrequency(void)
+{
+  if (_bypass) return(0);
+
+  uint32_t folded = (_phase & 0x80000000UL) ? -_phase : _phase;
+
+  return((uint16_t)((((uint64_t)folded * 1000000UL) / (_period >> PERIOD_FRAC)) >> 32));
+}
+
+int32_t MD_HX711_FilterNotch::apply(int32_t value, uint32_t time)
+// Measure the sample period and retune if it has changed by 
+// more than 1/4096, then apply the notch.
+{
+  const uint8_t MAX_GAPS = 4;   // consecutive long periods to restart the measurement
+
+  if (_lastValid)
+  {
+    uint32_t dt = time - _lastTime;
+    uint32_t p = _period >> PERIOD_FRAC;
+
+    if (dt < p + p / 2)
+    {
+      _gaps = 0;
+      _period += (int32_t)((dt << PERIOD_FRAC) - _period) >> PERIOD_FRAC;
+    }
+    else if (++_gaps >= MAX_GAPS)   // not a gap (eg, missed conversion) but a slower rate
+    {
+      _gaps = 0;
+      _period = dt << PERIOD_FRAC;
+    }
+
+    uint32_t diff = (_period > _tuned) ? _period - _tuned : _tuned - _period;
+
+    if (diff > (_tuned >> 12)) tune();
+  }
+  _lastTime = time;
+  _lastValid = true;
+
+  if (_bypass) return(value);
+
+  return(MD_HX711_FilterBiquad::apply(value, time));
+}
+
+static int64_t limitCov(int64_t v)
+// Limit a covariance value so that products with gains
+// and time values fit in 64 bits
+{
+  const int64_t MAX_COV = (int64_t)1 << 44;
+
+  if (v > MAX_COV) return(MAX_COV);
+  if (v < -MAX_COV) return(-MAX_COV);
+  return(v);
+}
+
+void MD_HX711_FilterKalman::setNoise(uint32_t measureNoise, uint32_t processNoise)
+{
+  _r = limitCov(((int64_t)measureNoise * measureNoise) << COV_FRAC);
+  _q = limitCov(((int64_t)processNoise * processNoise) << COV_FRAC);
+  if (_r == 0) _r = 1;
+  reset();
+}
+
+int32_t MD_HX711_FilterKalman::getRate(void)
+{
+  uint8_t seq;
+  int64_t v;
+
+  do
+  {
+    while ((seq = _seq) & 1) { }  // wait out an update in progress
+    v = _v;
+  } while (seq != _seq);
+
+  return((int32_t)((v + (1L << (STATE_FRAC - 1))) >> STATE_FRAC));
+}
+
+int32_t MD_HX711_FilterKalman::apply(int32_t value, uint32_t time)
+// Predict the state forward by the time since the last sample,
+// then update it with the new sample.
+{
+  const int64_t ONE = (int64_t)1 << STATE_FRAC;
+  int64_t z = (int64_t)value * ONE;
+
+  _seq++;       // odd - update in progress
+  if (!_valid)
+  {
+    // start at the sample value with unknown rate
+    _w = z;
+    _v = 0;
+    _p00 = _r;
+    _p01 = 0;
+    _p11 = limitCov((int64_t)1 << 62);
+    _lastDt = 0;
+    _t = 0;
+    _valid = true;
+  }
+  else
+  {
+    uint32_t dt = time - _lastTime;
+
+    if (dt != _lastDt)    // only work out the time in seconds when it changes
+    {
+      if (dt > 1000000UL) dt = 1000000UL;
+      _lastDt = dt;
+      _t = (int32_t)((((uint64_t)dt << STATE_FRAC) + 500000UL) / 1000000UL);
+    }
+
+    // predict, with process noise Q = q * [T^4/4 T^3/2; T^3/2 T^2]
+    int64_t t = _t;
+    int64_t qt2 = (((_q * t) >> STATE_FRAC) * t) >> STATE_FRAC;
+    int64_t qt3 = (qt2 * t) >> STATE_FRAC;
+    int64_t qt4 = (qt3 * t) >> STATE_FRAC;
+    int64_t tp11 = (t * _p11) >> STATE_FRAC;
+
+    _w += (_v * t) >> STATE_FRAC;
+    _p00 = limitCov(_p00 + ((2 * t * _p01) >> STATE_FRAC) + ((t * tp11) >> STATE_FRAC) + qt4 / 4);
+    _p01 = limitCov(_p01 + tp11 + qt3 / 2);
+    _p11 = limitCov(_p11 + qt2);
+
+    // update, gains K = P[.][0] / (P00 + R) with STATE_FRAC fraction bits.
+    // k1 can be as large as 1/T, so its products are split to fit.
+    int64_t s = _p00 + _r;
+    int64_t k0 = (_p00 * ONE) / s;
+    int64_t k1 = (_p01 * ONE) / s;
+    int64_t y = z - _w;
+
+    _w += (k0 * y) >> STATE_FRAC;
+    _v += (k1 * (y >> 8)) >> (STATE_FRAC - 8);
+    _p11 = limitCov(_p11 - ((k1 * (_p01 >> 8)) >> (STATE_FRAC - 8)));
+    _p01 = limitCov(_p01 - ((k0 * _p01) >> STATE_FRAC));
+    _p00 = limitCov(_p00 - ((k0 * _p00) >> STATE_FRAC));
+  }
+  _lastTime = time;
+  _seq++;       // even - update completed
+
+  return((int32_t)((_w + (ONE >> 1)) >> STATE_FRAC));
+}
+
+void MD_HX711_FilterDecimate::setSize(uint16_t size)
+{
+  if (size > MAX_SIZE) size = MAX_SIZE;
+  if (size == 0) size = 1;
+
+  _shift = 0;
+  while ((2UL << _shift) <= size)
+    _shift++;
+
+  reset();
+}
+
+void MD_HX711_FilterDecimate::reset(void)
+// Not used by the ISR while called, as for the other filters
+{
+  _n = 0;
+  _acc = 0;
+  _valid = false;
+  _readCount = 0;
+  _out.value = 0;
+  _out.fracBits = getFracBits();
+  _out.samples = getSize();
+  _out.time = 0;
+  _out.count = 0;
+}
+
+bool MD_HX711_FilterDecimate::getOutput(output_t &out)
+{
+  uint8_t seq;
+
+  do
+  {
+    while ((seq = _seq) & 1) { }  // wait out an update in progress
+    out.value = _out.value;
+    out.fracBits = _out.fracBits;
+    out.samples = _out.samples;
+    out.time = _out.time;
+    out.count = _out.count;
+  } while (seq != _seq);
+
+  bool b = (out.count != _readCount);
+
+  _readCount = out.count;
+
+  return(b);
+}
+
+int32_t MD_HX711_FilterDecimate::apply(int32_t value, uint32_t time)
+// Integrate the samples and dump the sum at the end of each block.
+// 16384 x 24 bit samples need 38 bits.
+{
+  _acc += value;
+  if (++_n >= getSize())
+  {
+    uint8_t f = getFracBits();
+    uint8_t s = _shift - f;
+    int64_t r = (s == 0) ? 0 : ((int64_t)1 << (s - 1));
+
+    _seq++;     // odd - update in progress
+    _out.value = (int32_t)((_acc + r) >> s);
+    _out.time = time;
+    _out.count++;
+    _seq++;     // even - update completed
+    _held = (int32_t)((_acc + ((int64_t)1 << _shift >> 1)) >> _shift);
+    _valid = true;
+    _acc = 0;
+    _n = 0;
+  }
+
+  return(_valid ? _held : value);
+}
@@ -0,0 +1,652 @@
+#pragma once
+
+#include "MD_HX711.h"
+
+/**
+ * \file
+ * \brief Header file for the MD_HX711 data filter classes.
+ */
+
+/**
+ * Data filter base class.
+ *
+ * A filter processes each sample received for a channel, in the order they
+ * are received. A filter is attached to a channel using MD_HX711::setFilter()
+ * and is then called from the library sample path, which may be in the ISR.
+ * Filters must therefore be fast, use only integer arithmetic and must not
+ * allocate memory or block.
+ *
+ * A filter object holds the state for one channel and must not be shared
+ * between channels or devices.
+ */
+class MD_HX711_Filter
+{
+public:
+  virtual ~MD_HX711_Filter(void) {}
+
+  /**
+   * Reset the filter state.
+   *
+   * The next sample applied restarts the filter.
+   */
+  virtual void reset(void) = 0;
+
+  /**
+   * Apply the filter to a new sample.
+   *
+   * \param value the new sample value.
+   * \param time  the timestamp for the sample.
+   * \return the filter output after this sample.
+   */
+  virtual int32_t apply(int32_t value, uint32_t time) = 0;
+};
+
+/**
+ * Moving average filter.
+ *
+ * The output is the average of the last N samples (a boxcar filter), where
+ * N is a power of 2. The average is kept as a running sum, so each sample
+ * takes one addition, one subtraction and one shift, independent of N.
+ *
+ * The first sample after a reset fills the whole window, so the output
+ * starts at the first value rather than ramping up from zero.
+ *
+ * The sample storage is allocated by the application and must remain valid
+ * while it is in use.
+ *
+ *     int32_t avgBuf[16];
+ *     MD_HX711_FilterAvg avg(avgBuf, 16);
+ *
+ *     scale.setFilter(&avg);
+ */
+class MD_HX711_FilterAvg : public MD_HX711_Filter
+{
+public:
+  static const uint8_t MAX_SIZE = 128;  ///< Largest window size
+
+  /**
+   * Class Constructor
+   *
+   * \param buf  pointer to the sample storage.
+   * \param size the number of elements in buf. Must be a power of 2 no greater
+   *             than MAX_SIZE, otherwise the next lower power of 2 is used.
+   */
+  MD_HX711_FilterAvg(int32_t *buf, uint8_t size);
+
+  /**
+   * Get the window size.
+   *
+   * \return the number of samples averaged.
+   */
+  inline uint8_t getSize(void) { return(_mask + 1); }
+
+  // MD_HX711_Filter interface
+  virtual void reset(void) { _valid = false; }
+  virtual int32_t apply(int32_t value, uint32_t time);
+
+private:
+  int32_t *_buf;    ///< sample storage
+  uint8_t _mask;    ///< window size - 1
+  uint8_t _shift;   ///< log2 of the window size
+  uint8_t _idx;     ///< index of the oldest sample
+  bool _valid;      ///< false until the first sample after a reset
+  int32_t _sum;     ///< running sum of the samples in the window
+};
+
+/**
+ * Median filter.
+ *
+ * The output is the median of the last 3, 5 or 7 samples. A median filter
+ * removes single sample glitches (spikes) completely, where an averaging
+ * filter would spread them over several outputs. It is normally set as the
+ * prefilter for a channel (MD_HX711::setPreFilter()) so that glitches are
+ * removed before the data is used for tare, calibration or other filters.
+ *
+ * The window is kept as a sorted list, updated by removing the oldest sample
+ * and inserting the new one, so each sample takes at most SIZE compares and
+ * moves.
+ *
+ * If a limit is set, samples that differ from the median output by more than
+ * the limit are counted as rejected outliers. Glitches from the HX711 are
+ * often all ones (0xFFFFFF), which reads as -1.
+ *
+ *     MD_HX711_FilterMedian med(5, 10000);
+ *
+ *     scale.setPreFilter(&med);
+ */
+class MD_HX711_FilterMedian : public MD_HX711_Filter
+{
+public:
+  static const uint8_t MAX_SIZE = 7;    ///< Largest window size
+
+  /**
+   * Class Constructor
+   *
+   * \param size  the window size, 3, 5 or 7. Other values are rounded to one of these.
+   * \param limit the outlier limit, 0 to not count outliers.
+   */
+  MD_HX711_FilterMedian(uint8_t size = 3, int32_t limit = 0);
+
+  /**
+   * Set the outlier limit.
+   *
+   * \param limit the largest difference between a sample and the median output
+   *              that is not counted as rejected, 0 to not count outliers.
+   */
+  inline void setLimit(int32_t limit) { _limit = limit; }
+
+  /**
+   * Get the number of rejected outliers.
+   *
+   * \return the number of samples counted as rejected since the count was cleared.
+   */
+  inline uint16_t getRejected(void) { return(_rejected); }
+
+  /**
+   * Clear the rejected outlier count.
+   */
+  inline void clearRejected(void) { _rejected = 0; }
+
+  /**
+   * Get the window size.
+   *
+   * \return the number of samples in the window.
+   */
+  inline uint8_t getSize(void) { return(_size); }
+
+  // MD_HX711_Filter interface
+  virtual void reset(void) { _valid = false; }
+  virtual int32_t apply(int32_t value, uint32_t time);
+
+private:
+  uint8_t _size;      ///< window size
+  int32_t _limit;     ///< outlier limit, 0 for none
+  volatile uint16_t _rejected;  ///< outliers counted
+  bool _valid;        ///< false until the first sample after a reset
+  uint8_t _idx;       ///< index of the oldest sample in _hist
+  int32_t _hist[MAX_SIZE];    ///< samples in the order received
+  int32_t _sorted[MAX_SIZE];  ///< samples in sorted order
+};
+
+/**
+ * Exponential moving average filter.
+ *
+ * A first order IIR low pass filter where each output moves a fraction
+ * 1/2^shift of the way from the previous output to the new sample
+ *
+ *     out = out + (value - out) / 2^shift
+ *
+ * The filter state is kept with shift extra fraction bits, so each sample
+ * takes two shifts, one addition and one subtraction. Larger shift values
+ * give more smoothing and slower response. The time constant is about 2^shift
+ * samples.
+ *
+ *     MD_HX711_FilterEMA ema(3);
+ *
+ *     scale.setFilter(&ema);
+ */
+class MD_HX711_FilterEMA : public MD_HX711_Filter
+{
+public:
+  static const uint8_t MAX_SHIFT = 7;   ///< Largest shift value
+
+  /**
+   * Class Constructor
+   *
+   * \param shift the smoothing factor, 0 (no smoothing) to MAX_SHIFT.
+   */
+  MD_HX711_FilterEMA(uint8_t shift = 2) { setShift(shift); }
+
+  /**
+   * Set the smoothing factor.
+   *
+   * The filter is restarted from the next sample.
+   *
+   * \param shift the smoothing factor, 0 (no smoothing) to MAX_SHIFT.
+   */
+  void setShift(uint8_t shift) { _shift = (shift > MAX_SHIFT) ? MAX_SHIFT : shift; reset(); }
+
+  /**
+   * Get the smoothing factor.
+   *
+   * \return the shift value.
+   */
+  inline uint8_t getShift(void) { return(_shift); }
+
+  // MD_HX711_Filter interface
+  virtual void reset(void) { _valid = false; }
+  virtual int32_t apply(int32_t value, uint32_t time);
+
+private:
+  uint8_t _shift;   ///< smoothing factor
+  bool _valid;      ///< false until the first sample after a reset
+  int32_t _acc;     ///< output with _shift fraction bits
+};
+
+/**
+ * Second order (biquad) IIR filter.
+ *
+ * A general second order IIR filter in direct form I
+ *
+ *     y = b0*x + b1*x1 + b2*x2 - a1*y1 - a2*y2
+ *
+ * with Q4.28 fixed point coefficients and 64 bit arithmetic. The previous
+ * outputs are kept with FRAC_BITS extra fraction bits, and the rounding 
+ * error of each output is added to the next (error feedback), so there is
+ * no dead band however heavily the filter is smoothing. Each sample takes 
+ * five 32x64 bit multiplications.
+ *
+ * The coefficients are set directly using setCoeff() or worked out for a
+ * standard filter type, using floating point arithmetic at set up only.
+ *
+ *     MD_HX711_FilterBiquad lpf;
+ *
+ *     lpf.setLowPass(2.0, 80.0);   // 2Hz cutoff at 80 SPS
+ *     scale.setFilter(&lpf);
+ */
+class MD_HX711_FilterBiquad : public MD_HX711_Filter
+{
+public:
+  static const uint8_t COEFF_BITS = 28;   ///< Fraction bits in the coefficients
+  static const uint8_t FRAC_BITS = 6;     ///< Fraction bits in the output state
+
+  /**
+   * Class Constructor
+   *
+   * The filter passes the data unchanged until it is set up.
+   */
+  MD_HX711_FilterBiquad(void);
+
+  /**
+   * Set the filter coefficients.
+   *
+   * The a0 coefficient is assumed to be 1. The filter is restarted from the
+   * next sample.
+   *
+   * \param b0 Q4.28 coefficient for x.
+   * \param b1 Q4.28 coefficient for x1.
+   * \param b2 Q4.28 coefficient for x2.
+   * \param a1 Q4.28 coefficient for y1.
+   * \param a2 Q4.28 coefficient for y2.
+   */
+  void setCoeff(int32_t b0, int32_t b1, int32_t b2, int32_t a1, int32_t a2);
+
+  /**
+   * Set a Butterworth low pass filter.
+   *
+   * Work out the coefficients for a second order Butterworth low pass filter
+   * (maximally flat pass band, no overshoot in the frequency response).
+   *
+   * \param fc the cutoff (-3dB) frequency in Hz.
+   * \param fs the sample rate in Hz.
+   * \return true if the filter was set, false if fc is not less than fs/2.
+   */
+  bool setLowPass(float fc, float fs);
+
+  // MD_HX711_Filter interface
+  virtual void reset(void) { _valid = false; }
+  virtual int32_t apply(int32_t value, uint32_t time);
+
+protected:
+  /**
+   * Set the coefficients from normalized floating point values.
+   *
+   * \param b0 b0/a0 coefficient.
+   * \param b1 b1/a0 coefficient.
+   * \param b2 b2/a0 coefficient.
+   * \param a1 a1/a0 coefficient.
+   * \param a2 a2/a0 coefficient.
+   */
+  void setCoeffF(float b0, float b1, float b2, float a1, float a2);
+
+  /**
+   * Change the coefficients without restarting the filter.
+   *
+   * \param b0 Q4.28 coefficient for x.
+   * \param b1 Q4.28 coefficient for x1.
+   * \param b2 Q4.28 coefficient for x2.
+   * \param a1 Q4.28 coefficient for y1.
+   * \param a2 Q4.28 coefficient for y2.
+   */
+  void loadCoeff(int32_t b0, int32_t b1, int32_t b2, int32_t a1, int32_t a2);
+
+private:
+  int32_t _b0, _b1, _b2, _a1, _a2;  ///< Q4.28 coefficients
+  bool _valid;        ///< false until the first sample after a reset
+  int32_t _x1, _x2;   ///< previous inputs
+  int64_t _y1, _y2;   ///< previous outputs with FRAC_BITS fraction bits
+  int32_t _err;       ///< rounding error of the previous output, COEFF_BITS fraction bits
+};
+
+/**
+ * Adaptive exponential moving average filter.
+ *
+ * An exponential moving average filter (see MD_HX711_FilterEMA) where the
+ * smoothing factor changes with the data. When a sample differs from the
+ * output by more than the step threshold (eg, a load is placed on the scale)
+ * the filter changes to the fastest response (minimum shift). While the
+ * samples stay within the threshold the smoothing is increased by one step
+ * each time constant (2^shift samples), up to the maximum shift. This gives
+ * a fast response to load changes and heavy averaging when the load is
+ * stable.
+ *
+ * The step threshold can be fixed or automatic. The automatic threshold is
+ * 4 times the average difference between consecutive samples, which tracks
+ * the noise in the data, and not less than 4.
+ *
+ *     MD_HX711_FilterAdaptive adapt(1, 6);
+ *
+ *     scale.setFilter(&adapt);
+ */
+class MD_HX711_FilterAdaptive : public MD_HX711_Filter
+{
+public:
+  static const uint8_t MAX_SHIFT = 7;   ///< Largest shift value
+  static const uint8_t FRAC_BITS = 6;   ///< Fraction bits in the filter state
+
+  /**
+   * Class Constructor
+   *
+   * \param minShift  the fastest response smoothing factor.
+   * \param maxShift  the slowest response smoothing factor, up to MAX_SHIFT.
+   * \param threshold the step threshold, 0 for automatic.
+   */
+  MD_HX711_FilterAdaptive(uint8_t minShift = 1, uint8_t maxShift = 6, int32_t threshold = 0);
+
+  /**
+   * Set the step threshold.
+   *
+   * \param threshold the step threshold, 0 for automatic.
+   */
+  inline void setThreshold(int32_t threshold) { _threshold = threshold; }
+
+  /**
+   * Get the current smoothing factor.
+   *
+   * \return the shift value currently used by the filter.
+   */
+  inline uint8_t getShift(void) { return(_shift); }
+
+  /**
+   * Check if the filter has settled.
+   *
+   * \return true if the filter is at the maximum smoothing (the data is stable).
+   */
+  inline bool isSettled(void) { return(_shift == _maxShift); }
+
+  // MD_HX711_Filter interface
+  virtual void reset(void) { _valid = false; }
+  virtual int32_t apply(int32_t value, uint32_t time);
+
+private:
+  uint8_t _minShift;    ///< fastest response shift
+  uint8_t _maxShift;    ///< slowest response shift
+  int32_t _threshold;   ///< step threshold, 0 for automatic
+  bool _valid;          ///< false until the first sample after a reset
+  volatile uint8_t _shift;  ///< current shift
+  uint8_t _count;       ///< samples since the last change in _shift
+  int32_t _acc;         ///< output with FRAC_BITS fraction bits
+  int32_t _dev;         ///< average sample to sample difference with FRAC_BITS fraction bits
+  int32_t _last;        ///< previous sample with FRAC_BITS fraction bits
+};
+
+/**
+ * Mains frequency notch filter.
+ *
+ * At 80 samples per second the HX711 does not reject mains (50Hz or 60Hz)
+ * interference, which appears in the data as an alias at a lower frequency
+ * (eg, 50Hz at 80 SPS appears at 30Hz). This filter is a second order notch
+ * filter placed at the alias frequency.
+ *
+ * The alias frequency depends on the actual sample rate of the HX711, which
+ * varies with its internal oscillator. The filter measures the sample period
+ * from the sample timestamps (which must be in microseconds, the default) and
+ * retunes the notch when the period changes. The notch is tuned using integer
+ * arithmetic only, so this is safe in the ISR. Retuning takes two 64 bit 
+ * divisions, for the alias frequency and the unity gain at DC, and the cosine
+ * is evaluated using multiplies only. If the alias is close to 0Hz
+ * (eg, at 10 SPS, where the HX711 rejects the mains frequency itself) the
+ * filter passes the data unchanged.
+ *
+ * The width of the notch is set by the pole radius, from 0 to 255 (as a
+ * fraction of 256). Larger values give a narrower notch and a longer
+ * settling time.
+ *
+ *     MD_HX711_FilterNotch notch(50);
+ *
+ *     scale.setFilter(&notch);
+ */
+class MD_HX711_FilterNotch : public MD_HX711_FilterBiquad
+{
+public:
+  /**
+   * Class Constructor
+   *
+   * \param mains  the mains frequency in Hz.
+   * \param radius the notch pole radius in 1/256 units.
+   * \param period the initial sample period in microseconds.
+   */
+  MD_HX711_FilterNotch(uint8_t mains = 50, uint8_t radius = 230, uint32_t period = MD_HX711::PERIOD_80SPS);
+
+  /**
+   * Get the measured sample period.
+   *
+   * \return the average sample period in microseconds.
+   */
+  inline uint32_t getPeriod(void) { return(_period >> PERIOD_FRAC); }
+
+  /**
+   * Get the notch frequency.
+   *
+   * \return the alias frequency of the mains in Hz, 0 if the notch is not used.
+   */
+  uint16_t getNotchFrequency(void);
+
+  // MD_HX711_Filter interface
+  virtual void reset(void) { _lastValid = false; _gaps = 0; MD_HX711_FilterBiquad::reset(); }
+  virtual int32_t apply(int32_t value, uint32_t time);
+
+private:
+  static const uint8_t PERIOD_FRAC = 4;   ///< fraction bits in the period average
+
+  uint8_t _mains;       ///< mains frequency in Hz
+  uint8_t _radius;      ///< pole radius in 1/256 units
+  bool _lastValid;      ///< true when _lastTime is valid
+  bool _bypass;         ///< true if the notch is not used
+  uint8_t _gaps;        ///< consecutive periods too long for the average
+  uint32_t _lastTime;   ///< timestamp of the previous sample
+  uint32_t _period;     ///< average sample period with PERIOD_FRAC fraction bits
+  uint32_t _tuned;      ///< sample period when the notch was last tuned
+  uint32_t _phase;      ///< alias frequency as a fraction of the sample rate (Q32 turns)
+
+  void tune(void);      ///< work out the notch coefficients for _period
+  static int32_t cosTurn(uint32_t phase);   ///< cos of a Q32 fraction of a turn, in Q28
+};
+
+/**
+ * Kalman filter for weight and rate of change.
+ *
+ * A two state (weight and rate of change of weight) Kalman filter using a
+ * constant rate model, where the rate is changed by random accelerations.
+ * The filter output is the estimated weight, and the estimated rate (eg,
+ * for flow control while dosing) is read using getRate().
+ *
+ * The filter is tuned with two values:
+ * - the measurement noise, the standard deviation of the samples about the
+ *   true value, in ADC counts. This is the noise seen with a stable load.
+ * - the process noise, the standard deviation of the acceleration of the
+ *   weight, in ADC counts per second per second. Larger values follow
+ *   changes more quickly, smaller values give smoother output.
+ *
+ * The time between samples is taken from the sample timestamps, which must
+ * be in microseconds (the default).
+ *
+ * The filter is evaluated in fixed point with 64 bit arithmetic (16 fraction
+ * bits for the state and 8 for the covariance) and two 64 bit divisions per
+ * sample.
+ *
+ *     MD_HX711_FilterKalman kalman(50, 2000);
+ *
+ *     scale.setFilter(&kalman);
+ *     ...
+ *     int32_t rate = kalman.getRate();
+ */
+class MD_HX711_FilterKalman : public MD_HX711_Filter
+{
+public:
+  /**
+   * Class Constructor
+   *
+   * \param measureNoise the measurement noise standard deviation in ADC counts.
+   * \param processNoise the process noise standard deviation in ADC counts/s^2.
+   */
+  MD_HX711_FilterKalman(uint32_t measureNoise = 100, uint32_t processNoise = 1000) : _seq(0) { setNoise(measureNoise, processNoise); }
+
+  /**
+   * Set the filter noise values.
+   *
+   * The filter is restarted from the next sample.
+   *
+   * \param measureNoise the measurement noise standard deviation in ADC counts.
+   * \param processNoise the process noise standard deviation in ADC counts/s^2.
+   */
+  void setNoise(uint32_t measureNoise, uint32_t processNoise);
+
+  /**
+   * Get the estimated rate of change.
+   *
+   * This may be called from an immediate mode callback (in the ISR).
+   *
+   * \return the rate of change of the filter output in ADC counts per second, 0 until started.
+   */
+  int32_t getRate(void);
+
+  // MD_HX711_Filter interface
+  virtual void reset(void) { _valid = false; _v = 0; }
+  virtual int32_t apply(int32_t value, uint32_t time);
+
+private:
+  static const uint8_t STATE_FRAC = 16;   ///< fraction bits in the state and time
+  static const uint8_t COV_FRAC = 8;      ///< fraction bits in the covariance
+
+  int64_t _r;       ///< measurement noise variance
+  int64_t _q;       ///< process noise variance
+  bool _valid;      ///< false until the first sample after a reset
+  uint32_t _lastTime; ///< timestamp of the previous sample
+  uint32_t _lastDt; ///< previous sample period in us
+  int32_t _t;       ///< previous sample period in seconds, STATE_FRAC fraction bits
+  int64_t _w;       ///< estimated weight, STATE_FRAC fraction bits
+  volatile int64_t _v;  ///< estimated rate, STATE_FRAC fraction bits
+  volatile uint8_t _seq;  ///< sequence counter, odd while apply() is updating _v
+  int64_t _p00, _p01, _p11;   ///< covariance matrix
+};
+
+/**
+ * Decimating (accumulate and dump) filter.
+ *
+ * The filter sums blocks of N samples, where N is a power of 2, and produces
+ * one output for each block, so the output rate is the sample rate divided
+ * by N. This is a first order CIC (cascaded integrator comb) decimator. For
+ * random noise, averaging N samples reduces the noise by sqrt(N), giving
+ * log2(N)/2 extra bits of effective resolution. This trades sample rate for
+ * resolution where the process is slow (eg, weighing at channel B gain 32).
+ *
+ * The block sum is kept in 64 bits. The output is the block mean with
+ * fraction bits for the extra resolution, read with its resolution
+ * metadata using getOutput(). Only additions are needed for each sample and
+ * one shift for each output.
+ *
+ * The filter output used by MD_HX711::getFiltered() is the block mean
+ * rounded to ADC counts, held until the next block is complete. Until the
+ * first block is complete after a reset, the samples are passed through.
+ *
+ *     MD_HX711_FilterDecimate decim(64);
+ *     MD_HX711_FilterDecimate::output_t out;
+ *
+ *     scale.setFilter(&decim, MD_HX711::CH_B);
+ *     ...
+ *     if (decim.getOutput(out))
+ *     {
+ *       int32_t tared = out.value - scale.getZeroTare(MD_HX711::CH_B) * (1L << out.fracBits);
+ *       ...
+ *     }
+ */
+class MD_HX711_FilterDecimate : public MD_HX711_Filter
+{
+public:
+  static const uint16_t MAX_SIZE = 16384;  ///< Largest block size
+
+  /**
+   * Decimated output type.
+   *
+   * \sa getOutput()
+   */
+  typedef struct
+  {
+    int32_t value;    ///< block mean (not tared) with fracBits fraction bits
+    uint8_t fracBits; ///< number of fraction bits in value
+    uint16_t samples; ///< number of samples in the block
+    uint32_t time;    ///< timestamp of the last sample in the block
+    uint32_t count;   ///< number of outputs since the filter was reset
+  } output_t;
+
+  /**
+   * Class Constructor
+   *
+   * \param size the number of samples in each block. Must be a power of 2 no
+   *             greater than MAX_SIZE, otherwise the next lower power of 2 is used.
+   */
+  MD_HX711_FilterDecimate(uint16_t size = 16) : _seq(0) { setSize(size); }
+
+  /**
+   * Set the block size.
+   *
+   * The filter is reset, so this must not be called while the filter is set 
+   * for a channel.
+   *
+   * \param size the number of samples in each block. Must be a power of 2 no
+   *             greater than MAX_SIZE, otherwise the next lower power of 2 is used.
+   */
+  void setSize(uint16_t size);
+
+  /**
+   * Get the block size.
+   *
+   * \return the number of samples in each block.
+   */
+  inline uint16_t getSize(void) { return(1 << _shift); }
+
+  /**
+   * Get the number of output fraction bits.
+   *
+   * This is the extra resolution gained by the averaging, log2(size)/2
+   * rounded down so it is not overstated.
+   *
+   * \return the number of fraction bits in the output value.
+   */
+  inline uint8_t getFracBits(void) { return(_shift / 2); }
+
+  /**
+   * Get the latest decimated output.
+   *
+   * This may be called from an immediate mode callback (in the ISR).
+   *
+   * \param out the output_t structure to receive the data.
+   * \return true if this is a new output since the last call, false if no block has completed since.
+   */
+  bool getOutput(output_t &out);
+
+  // MD_HX711_Filter interface
+  virtual void reset(void);
+  virtual int32_t apply(int32_t value, uint32_t time);
+
+private:
+  uint8_t _shift;       ///< log2 of the block size
+  uint16_t _n;          ///< samples in the current block
+  int64_t _acc;         ///< sum of the samples in the current block
+  int32_t _held;        ///< last block mean in ADC counts
+  bool _valid;          ///< false until the first block after a reset
+  uint32_t _readCount;  ///< output count at the last getOutput()
+  volatile uint8_t _seq;  ///< sequence counter, odd while apply() is updating _out
+  volatile output_t _out; ///< latest decimated output
+};
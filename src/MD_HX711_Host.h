@@ -0,0 +1,119 @@
+#pragma once
+/**
+ * \file
+ * \brief Host (non-Arduino) build support for the MD_HX711 library.
+ *
+ * This file is included by MD_HX711.h in place of Arduino.h when the library
+ * is not compiled by the Arduino toolchain (ARDUINO is not defined). It
+ * provides the subset of the Arduino API used by the library so that the
+ * library can be built and run on a host computer (eg, Linux).
+ *
+ * - Time is simulated. delayMicroseconds() and yield() advance the simulated
+ *   clock returned by micros() and millis().
+ * - Pin I/O is routed to the pin handler set by MD_HX711_Host::setPins(). If
+ *   no handler is set, outputs are ignored and inputs read HIGH.
+ * - There are no interrupts and no pin supports external interrupts. 
+ *   noInterrupts() and interrupts() record the longest time interrupts are 
+ *   disabled, returned by MD_HX711_Host::getMaxMasked().
+ *
+ * Hardware is normally simulated using MD_HX711B with MD_HX711_SimBus, which
+ * bypasses the pin functions altogether.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+
+#define HIGH  1     ///< Digital pin HIGH level
+#define LOW   0     ///< Digital pin LOW level
+#define INPUT  0    ///< pinMode() input
+#define OUTPUT 1    ///< pinMode() output
+
+#define NOT_AN_INTERRUPT -1   ///< Pin does not support external interrupts
+
+#ifndef _BV
+#define _BV(b) (1UL << (b))   ///< Bit value
+#endif
+
+/**
+ * Host environment data and functions.
+ */
+namespace MD_HX711_Host
+{
+  /**
+   * Pin handler interface.
+   *
+   * Implemented by the application to simulate the hardware connected
+   * to the digital pins.
+   */
+  class pins_t
+  {
+  public:
+    virtual ~pins_t(void) {}
+    virtual void write(uint8_t pin, uint8_t value) = 0;  ///< digitalWrite() to the pin
+    virtual uint8_t read(uint8_t pin) = 0;               ///< digitalRead() from the pin
+  };
+
+  /** Simulated time in microseconds. */
+  inline uint32_t &now(void) { static uint32_t t = 0; return(t); }
+
+  /** Current pin handler. */
+  inline pins_t *&handler(void) { static pins_t *p = nullptr; return(p); }
+
+  /** Set the pin handler, nullptr for none. */
+  inline void setPins(pins_t *p) { handler() = p; }
+
+  /** Advance the simulated time. */
+  inline void advance(uint32_t us) { now() += us; }
+
+  /** Interrupt mask state. */
+  struct irq_t
+  {
+    bool masked;          ///< true if interrupts are disabled
+    uint32_t maskedAt;    ///< time interrupts were disabled
+    uint32_t maxMasked;   ///< longest time interrupts were disabled
+  };
+
+  /** Current interrupt mask state. */
+  inline irq_t &irq(void) { static irq_t i = { false, 0, 0 }; return(i); }
+
+  /** Longest time in us that interrupts were disabled since the last clearMaxMasked(). */
+  inline uint32_t getMaxMasked(void) { return(irq().maxMasked); }
+
+  /** Clear the longest time interrupts were disabled. */
+  inline void clearMaxMasked(void) { irq().maxMasked = 0; }
+}
+
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t pin, uint8_t value) { if (MD_HX711_Host::handler() != nullptr) MD_HX711_Host::handler()->write(pin, value); }
+inline int digitalRead(uint8_t pin) { return(MD_HX711_Host::handler() != nullptr ? MD_HX711_Host::handler()->read(pin) : HIGH); }
+
+inline unsigned long micros(void) { return(MD_HX711_Host::now()); }
+inline unsigned long millis(void) { return(MD_HX711_Host::now() / 1000); }
+inline void delayMicroseconds(unsigned int us) { MD_HX711_Host::advance(us); }
+inline void delay(unsigned long ms) { MD_HX711_Host::advance(ms * 1000); }
+inline void yield(void) { MD_HX711_Host::advance(1); }   // busy wait loops must let time pass
+
+inline void noInterrupts(void)
+{
+  MD_HX711_Host::irq_t &i = MD_HX711_Host::irq();
+
+  if (!i.masked) { i.masked = true; i.maskedAt = MD_HX711_Host::now(); }
+}
+
+inline void interrupts(void)
+{
+  MD_HX711_Host::irq_t &i = MD_HX711_Host::irq();
+
+  if (i.masked)
+  {
+    uint32_t t = MD_HX711_Host::now() - i.maskedAt;
+
+    i.masked = false;
+    if (t > i.maxMasked) i.maxMasked = t;
+  }
+}
+
+inline int8_t digitalPinToInterrupt(uint8_t) { return(NOT_AN_INTERRUPT); }
+inline void attachInterrupt(int8_t, void (*)(void), int) {}
+inline void detachInterrupt(int8_t) {}
@@ -0,0 +1,238 @@
+#pragma once
+
+#include "MD_HX711.h"
+
+/**
+ * \file
+ * \brief Header file for the MD_HX711_Sim HX711 device simulator.
+ */
+
+/**
+ * HX711 device simulator.
+ *
+ * This class models the HX711 serial protocol and conversion timing, as
+ * described in \ref pageControl, and is connected to the library through
+ * MD_HX711_SimBus. It is used to test and benchmark the library without
+ * hardware, usually on a host computer with simulated time (see
+ * MD_HX711_Host.h), but also runs on Arduino hardware using micros().
+ *
+ * The model includes
+ * - data ready (DAT low) at the configured conversion period (10 or 80 SPS).
+ * - 25, 26 or 27 CLK pulses selecting the channel and gain for the __next__
+ *   conversion, with 4 conversion periods of settling after a change.
+ * - power down when CLK is HIGH for more than 60us, and reset to Channel A
+ *   gain 128 when CLK returns LOW.
+ * - serial communication error for fewer than 25 (abandoned read) or more
+ *   than 27 CLK pulses. DAT is held HIGH until the next power down reset.
+ * - new data replacing old data if it is not read before the next conversion.
+ *
+ * Input values are set using setInput() or supplied by a source function set
+ * with setSource(). Channel A gain 64 returns half the Channel A value. Values
+ * are limited to the 24 bit output range.
+ *
+ *     MD_HX711_Sim hx711(MD_HX711_Sim::PERIOD_80SPS);
+ *     MD_HX711B<MD_HX711_SimBus> scale((MD_HX711_SimBus(&hx711)));
+ */
+class MD_HX711_Sim : public MD_HX711_SimBus::device_t
+{
+public:
+  /**
+   * Input source function type.
+   *
+   * The function returns the input value for channel A (chB false) or
+   * channel B (chB true) at the specified time.
+   */
+  typedef int32_t (*source_t)(bool chB, uint32_t time);
+
+  static const uint32_t PERIOD_10SPS = 100000;  ///< Conversion period in us for 10 SPS
+  static const uint32_t PERIOD_80SPS = 12500;   ///< Conversion period in us for 80 SPS
+  static const uint8_t SETTLE = 4;              ///< Conversion periods needed to settle after reset or mode change
+  static const uint8_t PD_TIME = 60;            ///< CLK HIGH time in us to power down
+
+  /**
+   * Class Constructor
+   *
+   * \param period the conversion period in us.
+   */
+  MD_HX711_Sim(uint32_t period = PERIOD_10SPS) : _period(period), _source(nullptr)
+  {
+    _input[0] = _input[1] = 0;
+    _clk = false;
+    reset();
+    clearStats();
+  }
+
+  /**
+   * Reset the device as if powered on.
+   */
+  void reset(void) { powerReset(micros()); }
+
+  /**
+   * Set the conversion period.
+   *
+   * \param period the conversion period in us.
+   */
+  inline void setPeriod(uint32_t period) { _period = period; }
+
+  /**
+   * Set a fixed input value.
+   *
+   * \param chB   true for channel B, false for channel A.
+   * \param value the output value for the channel (Channel A at gain 128).
+   */
+  inline void setInput(bool chB, int32_t value) { _input[chB ? 1 : 0] = value; }
+
+  /**
+   * Set the input source function.
+   *
+   * \param fn the source function, nullptr to use the setInput() values.
+   */
+  inline void setSource(source_t fn) { _source = fn; }
+
+  //--------------------------------------------------------------
+  /** \name Simulation statistics.
+   * @{
+   */
+  inline uint32_t getEdges(void) { return(_edges); }     ///< CLK edges received
+  inline uint32_t getReads(void) { return(_reads); }     ///< valid read cycles completed
+  inline uint32_t getErrors(void) { return(_errors); }   ///< serial communication errors
+  inline uint32_t getMaxClkHigh(void) { return(_maxHigh); } ///< longest CLK HIGH time in a read cycle (us)
+  inline bool isError(void) { return(_error); }          ///< true if in serial error state
+  inline bool isPowerDown(void) { return(_clk && (micros() - _clkHighAt > PD_TIME)); }  ///< true if powered down
+
+  /** Clear all the statistics counters. */
+  void clearStats(void) { _edges = _reads = _errors = _maxHigh = 0; }
+  /** @} */
+
+  // MD_HX711_SimBus::device_t interface
+  virtual void clk(bool high)
+  {
+    uint32_t now = micros();
+
+    update(now);
+    if (high == _clk) return;
+
+    _edges++;
+    if (high)
+    {
+      _clkHighAt = now;
+      _clk = true;
+
+      if (_error) return;
+      if (_pulses == 0)   // start of a read cycle
+      {
+        _shift = _data;
+        _ready = false;
+      }
+      _pulses++;
+      if (_pulses > 27)
+        serialError();
+    }
+    else
+    {
+      uint32_t t = now - _clkHighAt;
+
+      _clk = false;
+      if (t > PD_TIME)    // was powered down, now restart
+        powerReset(now);
+      else if (t > _maxHigh)
+        _maxHigh = t;
+    }
+    _lastEdge = now;
+  }
+
+  virtual bool dat(void)
+  {
+    uint32_t now = micros();
+
+    update(now);
+    if (_error || (_clk && (now - _clkHighAt > PD_TIME))) return(true);
+    if (_pulses == 0) return(!_ready);
+    if (_pulses <= 24) return(((_shift >> (24 - _pulses)) & 1) != 0);
+    return(true);
+  }
+
+private:
+  uint32_t _period;     ///< conversion period
+  int32_t _input[2];    ///< fixed inputs for channels A, B
+  source_t _source;     ///< input source function
+
+  bool _clk;            ///< current CLK level
+  uint32_t _clkHighAt;  ///< time CLK last went HIGH
+  uint32_t _lastEdge;   ///< time of the last CLK edge
+  uint8_t _pulses;      ///< CLK pulses in the current read cycle
+  uint8_t _mode;        ///< current conversion mode (25, 26 or 27 pulses)
+  bool _ready;          ///< data ready (DAT low)
+  bool _error;          ///< serial error state
+  uint32_t _readyAt;    ///< time the next conversion completes
+  uint32_t _data;       ///< latest conversion output register
+  uint32_t _shift;      ///< data being shifted out
+
+  uint32_t _edges, _reads, _errors, _maxHigh;  ///< statistics
+
+  void powerReset(uint32_t now)
+  // restart in the power on default mode
+  {
+    _pulses = 0;
+    _mode = 25;
+    _ready = false;
+    _error = false;
+    _data = 0;
+    _readyAt = now + SETTLE * _period;
+    _lastEdge = now;
+  }
+
+  void serialError(void)
+  {
+    _error = true;
+    _ready = false;
+    _errors++;
+  }
+
+  uint32_t sample(uint32_t time)
+  // conversion output for the current mode
+  {
+    bool chB = (_mode == 26);
+    int32_t v = (_source != nullptr) ? _source(chB, time) : _input[chB ? 1 : 0];
+
+    if (_mode == 27) v /= 2;          // Channel A gain 64
+    if (v > 0x7fffff) v = 0x7fffff;
+    if (v < -0x800000L) v = -0x800000L;
+
+    return(uint32_t(v) & 0xffffff);
+  }
+
+  void update(uint32_t now)
+  // process all the conversions completed up to now
+  {
+    if (_error || (_clk && (now - _clkHighAt > PD_TIME))) return;
+
+    while ((int32_t)(now - _readyAt) >= 0)
+    {
+      if (_pulses != 0)   // a read cycle has started
+      {
+        if (_pulses < 25)
+        {
+          // abandoned read is an error, otherwise still reading
+          if (now - _lastEdge > _period) serialError();
+          return;
+        }
+
+        // read cycle completed, set up the next conversion
+        _reads++;
+        if (_pulses != _mode)
+        {
+          _mode = _pulses;
+          _pulses = 0;
+          _readyAt += (SETTLE - 1) * _period;
+          continue;
+        }
+        _pulses = 0;
+      }
+
+      _data = sample(_readyAt);
+      _ready = true;
+      _readyAt += _period;
+    }
+  }
+};
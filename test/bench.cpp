@@ -0,0 +1,218 @@
+// Host benchmark of the library acquisition and data processing methods.
+//
+// Reports the host processor time per sample for each method and counts the
+// GPIO operations and CLK edges for each read cycle, measured against the
+// MD_HX711_Sim simulated device. The time is for the library code only as
+// the simulated delays take no time. Run using 'make bench' and compare the
+// results with previous releases.
+
+#include <stdio.h>
+#include <chrono>
+#include <MD_HX711.h>
+#include <MD_HX711_Sim.h>
+#include <MD_HX711_Cal.h>
+#include <MD_HX711_Filter.h>
+
+const uint8_t PIN_CLK = 4;
+const uint8_t PIN_DAT = 2;
+
+const uint32_t LOOPS = 1000000;   // number of times each processing method is run
+const uint16_t READS = 2000;      // number of read cycles timed
+
+typedef std::chrono::steady_clock clock_t_;
+
+static double nsSince(clock_t_::time_point t, uint32_t n)
+{
+  return(std::chrono::duration<double, std::nano>(clock_t_::now() - t).count() / n);
+}
+
+// Simulated device on the host pins, counting the pin operations
+class Pins : public MD_HX711_Host::pins_t
+{
+public:
+  Pins(MD_HX711_Sim &dev) : writes(0), reads(0), _dev(dev) {}
+
+  uint32_t writes, reads;
+
+  virtual void write(uint8_t pin, uint8_t value) { if (pin == PIN_CLK) { writes++; _dev.clk(value == HIGH); } }
+  virtual uint8_t read(uint8_t pin) { if (pin != PIN_DAT) return(HIGH); reads++; return(_dev.dat() ? HIGH : LOW); }
+
+private:
+  MD_HX711_Sim &_dev;
+};
+
+static MD_HX711_Sim hx711(MD_HX711_Sim::PERIOD_80SPS);
+static Pins pins(hx711);
+
+template <class T> static void benchRead(const char *name, T &s, bool chB, MD_HX711::mode_t gain)
+// time the read cycles, excluding the time waiting for data ready
+{
+  double ns = 0;
+  uint32_t writes = 0, reads = 0;
+
+  hx711.reset();
+  s.begin();
+  s.setSamplePeriod(MD_HX711::PERIOD_80SPS);
+  s.enableChannelB(chB);
+  s.setGainA(gain);
+  s.read();     // mode change settles
+  s.read();
+  hx711.clearStats();
+
+  for (uint16_t i = 0; i < READS; i++)
+  {
+    while (!s.isReady()) { MD_HX711_Host::advance(100); }
+    pins.writes = pins.reads = 0;
+
+    clock_t_::time_point t = clock_t_::now();
+    s.read();
+    ns += nsSince(t, 1);
+
+    writes += pins.writes;
+    reads += pins.reads;
+  }
+
+  printf("%-28s %-4s %8.1f %9.1f %9.1f %9.1f\n", name, chB ? "A/B" : (gain == MD_HX711::GAIN_128 ? "A128" : "A64"),
+    ns / READS, (double)writes / READS, (double)reads / READS, (double)hx711.getEdges() / READS);
+  if (hx711.getErrors() != 0)
+    printf("  %lu serial errors!\n", (unsigned long)hx711.getErrors());
+}
+
+template <class T> static void benchReads(const char *name, T &s)
+{
+  benchRead(name, s, false, MD_HX711::GAIN_128);
+  benchRead(name, s, false, MD_HX711::GAIN_64);
+  benchRead(name, s, true, MD_HX711::GAIN_128);
+}
+
+static volatile int32_t sink;   // stop the results being optimized away
+
+static void report(const char *name, clock_t_::time_point t, int32_t value)
+{
+  printf("%-40s %8.1f   (value %ld)\n", name, nsSince(t, LOOPS), (long)value);
+}
+
+static void report(const char *name, clock_t_::time_point t, float value)
+{
+  printf("%-40s %8.1f   (value %.2f)\n", name, nsSince(t, LOOPS), value);
+}
+
+static void benchFilter(const char *name, MD_HX711_Filter &f)
+{
+  int32_t q = 0;
+
+  f.reset();
+  clock_t_::time_point t = clock_t_::now();
+  for (uint32_t i = 0; i < LOOPS; i++)
+    q = f.apply(1000 + (i & 0xf), i * MD_HX711::PERIOD_80SPS);
+  sink = q;
+  report(name, t, q);
+}
+
+int main(void)
+{
+  MD_HX711 scalePin(PIN_CLK, PIN_DAT);
+  MD_HX711T<PIN_CLK, PIN_DAT> scaleFast;
+  MD_HX711B<MD_HX711_SimBus> scaleSim((MD_HX711_SimBus(&hx711)));
+  int32_t q = 0;
+  float f = 0;
+
+  hx711.setInput(false, 100000L);
+  hx711.setInput(true, -50000L);
+
+  // acquisition
+  printf("Read cycle                   mode  ns/read  GPIO wr  GPIO rd  CLK edges\n");
+  MD_HX711_Host::setPins(&pins);
+  benchReads("MD_HX711::read()", scalePin);
+  benchReads("MD_HX711T::read()", scaleFast);
+  MD_HX711_Host::setPins(nullptr);
+  benchReads("MD_HX711B<SimBus>::read()", scaleSim);
+
+  // data processing
+  printf("\nProcessing                                ns/call\n");
+  scaleSim.begin();
+  scaleSim.read();
+  scaleSim.setZeroTare(1000);
+  scaleSim.setCalibration(200000L, 1000.0);
+
+  clock_t_::time_point t = clock_t_::now();
+  for (uint32_t i = 0; i < LOOPS; i++)
+    f += scaleSim.getCalibrated();
+  sink = (int32_t)f;
+  report("getCalibrated()", t, scaleSim.getCalibrated());
+
+  t = clock_t_::now();
+  for (uint32_t i = 0; i < LOOPS; i++)
+    q += scaleSim.getCalibratedFixed();
+  sink = q;
+  report("getCalibratedFixed()", t, scaleSim.getCalibratedFixed());
+
+  t = clock_t_::now();
+  for (uint32_t i = 0; i < LOOPS; i++)
+    q += scaleSim.getCalibratedInt(MD_HX711::CH_A, 1000);
+  sink = q;
+  report("getCalibratedInt()", t, scaleSim.getCalibratedInt(MD_HX711::CH_A, 1000));
+
+  // calibration table, uneven spacing (binary search)
+  MD_HX711_CalTable::point_t calPoints[8];
+  MD_HX711_CalTable calTable(calPoints, 8);
+
+  for (uint8_t i = 0; i < 8; i++)
+    calTable.addPoint(i * (30000L + i * 100), i * 125);
+  scaleSim.setCalCurve(&calTable);
+
+  t = clock_t_::now();
+  for (uint32_t i = 0; i < LOOPS; i++)
+    q += scaleSim.getCalibratedInt();
+  sink = q;
+  report("getCalibratedInt() CalTable", t, scaleSim.getCalibratedInt());
+
+  // 3rd order polynomial fitted to the table points
+  MD_HX711_CalPoly calPoly;
+  {
+    int32_t raw[8], value[8];
+
+    for (uint8_t i = 0; i < 8; i++)
+      calTable.getPoint(i, raw[i], value[i]);
+    calPoly.fit(raw, value, 8, 3);
+  }
+  scaleSim.setCalCurve(&calPoly);
+
+  t = clock_t_::now();
+  for (uint32_t i = 0; i < LOOPS; i++)
+    q += scaleSim.getCalibratedInt();
+  sink = q;
+  report("getCalibratedInt() CalPoly", t, scaleSim.getCalibratedInt());
+  scaleSim.setCalCurve(nullptr);
+
+  // filters
+  int32_t avgBuf[16];
+  MD_HX711_FilterAvg filterAvg(avgBuf, 16);
+  MD_HX711_FilterMedian filterMedian(5);
+  MD_HX711_FilterEMA filterEMA(3);
+  MD_HX711_FilterBiquad filterBiquad;
+  MD_HX711_FilterAdaptive filterAdaptive;
+  MD_HX711_FilterNotch filterNotch(50);
+  MD_HX711_FilterKalman filterKalman;
+  MD_HX711_FilterDecimate filterDecimate(16);
+
+  benchFilter("MD_HX711_FilterAvg(16)", filterAvg);
+  benchFilter("MD_HX711_FilterMedian(5)", filterMedian);
+  benchFilter("MD_HX711_FilterEMA(3)", filterEMA);
+  filterBiquad.setLowPass(2.0, 80.0);
+  benchFilter("MD_HX711_FilterBiquad", filterBiquad);
+  benchFilter("MD_HX711_FilterAdaptive", filterAdaptive);
+  benchFilter("MD_HX711_FilterNotch", filterNotch);
+  benchFilter("MD_HX711_FilterKalman", filterKalman);
+  benchFilter("MD_HX711_FilterDecimate(16)", filterDecimate);
+
+  // tare, simulated time including waiting for data
+  uint32_t start = micros();
+  uint32_t edges = hx711.getEdges();
+
+  scaleSim.autoZeroTare();
+  printf("\nautoZeroTare() %lu ms simulated, %lu CLK edges\n",
+    (unsigned long)(micros() - start) / 1000, (unsigned long)(hx711.getEdges() - edges));
+
+  return(0);
+}
@@ -0,0 +1,26 @@
+#pragma once
+/**
+ * \file
+ * \brief Minimal check macros for the MD_HX711 host tests.
+ */
+
+#include <stdio.h>
+
+static unsigned testChecks = 0;   ///< number of checks done
+static unsigned testFails = 0;    ///< number of checks failed
+
+/** Check a condition is true. */
+#define CHECK(c) \
+  do { testChecks++; if (!(c)) { testFails++; printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #c); } } while (false)
+
+/** Check two integer values are equal, printing both if not. */
+#define CHECK_EQ(a, b) \
+  do { long long va = (long long)(a), vb = (long long)(b); testChecks++; \
+       if (va != vb) { testFails++; printf("%s:%d: CHECK_EQ(%s, %s) failed, %lld != %lld\n", __FILE__, __LINE__, #a, #b, va, vb); } } while (false)
+
+/** Print the test results and return the process exit code. */
+inline int testSummary(const char *name)
+{
+  printf("%s: %u checks, %u failed\n", name, testChecks, testFails);
+  return(testFails == 0 ? 0 : 1);
+}
@@ -0,0 +1,100 @@
+// Host tests of MD_HX711Array with simulated devices sharing the CLK pin.
+
+#include <MD_HX711.h>
+#include <MD_HX711_Sim.h>
+#include "test.h"
+
+const uint8_t PIN_CLK = 4;
+const uint8_t PIN_DAT[] = { 2, 3, 5 };
+const uint8_t NUM_DEV = sizeof(PIN_DAT) / sizeof(PIN_DAT[0]);
+
+// Connect the simulated devices to the host pins
+class Pins : public MD_HX711_Host::pins_t
+{
+public:
+  Pins(MD_HX711_Sim *dev) : clkWrites(0), datReads(0), _dev(dev) {}
+
+  uint32_t clkWrites, datReads;   // pin access counts
+
+  virtual void write(uint8_t pin, uint8_t value)
+  {
+    if (pin != PIN_CLK) return;
+    clkWrites++;
+    for (uint8_t i = 0; i < NUM_DEV; i++)
+      _dev[i].clk(value == HIGH);
+  }
+
+  virtual uint8_t read(uint8_t pin)
+  {
+    datReads++;
+    for (uint8_t i = 0; i < NUM_DEV; i++)
+      if (pin == PIN_DAT[i]) return(_dev[i].dat() ? HIGH : LOW);
+    return(HIGH);
+  }
+
+private:
+  MD_HX711_Sim *_dev;
+};
+
+int main(void)
+{
+  MD_HX711_Sim hx[NUM_DEV] = { MD_HX711_Sim::PERIOD_80SPS, MD_HX711_Sim::PERIOD_80SPS, MD_HX711_Sim::PERIOD_80SPS };
+  Pins pins(hx);
+  MD_HX711Array<NUM_DEV> scales(PIN_CLK, PIN_DAT);
+
+  for (uint8_t i = 0; i < NUM_DEV; i++)
+  {
+    hx[i].setInput(false, 1000 * (i + 1));
+    hx[i].setInput(true, -100 * (i + 1));
+  }
+  MD_HX711_Host::setPins(&pins);
+
+  scales.begin();
+  for (uint8_t i = 0; i < 3; i++)
+  {
+    CHECK_EQ(scales.read(), MD_HX711::CH_A);
+    for (uint8_t d = 0; d < NUM_DEV; d++)
+      CHECK_EQ(scales.getRaw(d, MD_HX711::CH_A), 1000 * (d + 1));
+  }
+
+  scales.enableChannelB();
+  for (uint8_t i = 0; i < 6; i++)
+  {
+    MD_HX711::channel_t ch = scales.read();
+
+    CHECK_EQ(ch, (i & 1) ? MD_HX711::CH_B : MD_HX711::CH_A);
+    for (uint8_t d = 0; d < NUM_DEV; d++)
+      CHECK_EQ(scales.getRaw(d, ch), (ch == MD_HX711::CH_A ? 1000 : -100) * (d + 1));
+  }
+
+  // the shared CLK is driven once for all devices, each DAT is read for each bit
+  scales.enableChannelB(false);
+  while (!scales.isReady()) { yield(); }
+  pins.clkWrites = pins.datReads = 0;
+  scales.read();
+  CHECK_EQ(pins.clkWrites, 2 * 25);      // 24 data + 1 to select A gain 128
+  CHECK_EQ(pins.datReads, NUM_DEV * (1 + 24));  // isReady() + 24 data bits
+
+  // tare each device from the current readings
+  scales.autoZeroTare(4);
+  for (uint8_t d = 0; d < NUM_DEV; d++)
+  {
+    CHECK_EQ(scales.getZeroTare(d, MD_HX711::CH_A), 1000 * (d + 1));
+    hx[d].setInput(false, 1000 * (d + 1) + 50);
+  }
+  scales.read();
+  scales.read();    // the first read returns the conversion already started
+  for (uint8_t d = 0; d < NUM_DEV; d++)
+    CHECK_EQ(scales.getTared(d, MD_HX711::CH_A), 50);
+  CHECK(scales.getReadCount() > 0);
+
+  // the array state is much smaller than a full MD_HX711 object per device
+  CHECK(sizeof(scales) < NUM_DEV * sizeof(MD_HX711));
+
+  for (uint8_t d = 0; d < NUM_DEV; d++)
+    CHECK_EQ(hx[d].getErrors(), 0);
+
+  MD_HX711_Host::setPins(nullptr);
+
+  return(testSummary("test_array"));
+}
@@ -0,0 +1,146 @@
+// Host tests checking that all the MD_HX711 bus variants clock the same
+// bit stream to the HX711 and receive the same data.
+//
+// MD_HX711 and MD_HX711T are connected to MD_HX711_Sim through the host pin
+// functions (MD_HX711_Host::setPins()), MD_HX711B<MD_HX711_SimBus> directly.
+// Every CLK edge and DAT read is recorded with its time relative to the start
+// of the run and the recordings compared.
+
+#include <type_traits>
+#include <vector>
+#include <MD_HX711.h>
+#include <MD_HX711_Sim.h>
+#include "test.h"
+
+const uint8_t PIN_CLK = 4;
+const uint8_t PIN_DAT = 5;
+const uint8_t READS = 12;
+
+// the hardware objects must not need a vtable
+static_assert(!std::is_polymorphic<MD_HX711>::value, "MD_HX711 has virtual functions");
+static_assert(!std::is_polymorphic<MD_HX711T<PIN_CLK, PIN_DAT> >::value, "MD_HX711T has virtual functions");
+
+struct event_t
+{
+  char type;      // 'C' CLK change, 'D' DAT read
+  bool level;
+  uint32_t time;
+
+  bool operator==(const event_t &e) const { return(type == e.type && level == e.level && time == e.time); }
+};
+
+// Record the bus activity and pass it on to the simulated device
+class Recorder : public MD_HX711_SimBus::device_t, public MD_HX711_Host::pins_t
+{
+public:
+  Recorder(MD_HX711_Sim &dev) : _dev(dev), _start(0) {}
+
+  void start(void) { _log.clear(); _start = micros(); }
+  const std::vector<event_t> &log(void) { return(_log); }
+
+  // MD_HX711_SimBus::device_t
+  virtual void clk(bool high) { record('C', high); _dev.clk(high); }
+  virtual bool dat(void) { bool b = _dev.dat(); record('D', b); return(b); }
+
+  // MD_HX711_Host::pins_t
+  virtual void write(uint8_t pin, uint8_t value) { if (pin == PIN_CLK) clk(value == HIGH); }
+  virtual uint8_t read(uint8_t pin) { return(pin == PIN_DAT && dat() ? HIGH : LOW); }
+
+private:
+  MD_HX711_Sim &_dev;
+  uint32_t _start;
+  std::vector<event_t> _log;
+
+  void record(char type, bool level) { event_t e = { type, level, (uint32_t)(micros() - _start) }; _log.push_back(e); }
+};
+
+struct result_t
+{
+  std::vector<event_t> log;
+  std::vector<int32_t> raw;
+  std::vector<uint8_t> ch;
+};
+
+static uint32_t runStart;   // time the current run started
+
+static int32_t source(bool chB, uint32_t time)
+// changing input so each conversion is different, the same for each run
+{
+  time -= runStart;
+  return(chB ? -(int32_t)(time % 100000) : (int32_t)((time * 7) % 0x7fffff) - 0x400000);
+}
+
+template <class T> static result_t run(T &s, MD_HX711_Sim &hx, Recorder &rec)
+// the same sequence of operations for each variant
+{
+  result_t r;
+
+  runStart = micros();
+  hx.reset();
+  hx.clearStats();
+  rec.start();
+  s.begin();
+
+  for (uint8_t i = 0; i < READS; i++)
+  {
+    if (i == 4) s.enableChannelB();
+    if (i == 8) { s.enableChannelB(false); s.setGainA(MD_HX711::GAIN_64); }
+
+    MD_HX711::channel_t ch = s.read();
+
+    r.raw.push_back(s.getRaw(ch));
+    r.ch.push_back(ch);
+  }
+  r.log = rec.log();
+  CHECK_EQ(hx.getErrors(), 0);
+
+  return(r);
+}
+
+static void compare(const result_t &a, const result_t &b)
+{
+  CHECK_EQ(a.log.size(), b.log.size());
+  for (size_t i = 0; i < a.log.size() && i < b.log.size(); i++)
+  {
+    if (!(a.log[i] == b.log[i]))
+    {
+      printf("first difference at event %u: %c%d@%u != %c%d@%u\n", (unsigned)i,
+        a.log[i].type, a.log[i].level, (unsigned)a.log[i].time,
+        b.log[i].type, b.log[i].level, (unsigned)b.log[i].time);
+      CHECK(false);
+      break;
+    }
+  }
+
+  CHECK(a.raw == b.raw);
+  CHECK(a.ch == b.ch);
+}
+
+int main(void)
+{
+  MD_HX711_Sim hx(MD_HX711_Sim::PERIOD_80SPS);
+  Recorder rec(hx);
+
+  hx.setSource(source);
+
+  // run time pins through digitalWrite()/digitalRead()
+  MD_HX711_Host::setPins(&rec);
+  MD_HX711 plain(PIN_CLK, PIN_DAT);
+  result_t rPlain = run(plain, hx, rec);
+
+  // compile time pins
+  MD_HX711T<PIN_CLK, PIN_DAT> fast;
+  result_t rFast = run(fast, hx, rec);
+  MD_HX711_Host::setPins(nullptr);
+
+  // simulator bus
+  MD_HX711B<MD_HX711_SimBus> sim((MD_HX711_SimBus(&rec)));
+  result_t rSim = run(sim, hx, rec);
+
+  // 25 to 27 pulses per read, 2 edges each, and reset pulse
+  CHECK(rPlain.log.size() > 2 * 25 * READS);
+  compare(rPlain, rSim);
+  compare(rFast, rSim);
+
+  return(testSummary("test_bus"));
+}
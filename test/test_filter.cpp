@@ -0,0 +1,333 @@
+// Host tests of the MD_HX711 data filters.
+
+#include <math.h>
+#include <stdlib.h>
+#include <MD_HX711.h>
+#include <MD_HX711_Filter.h>
+#include "test.h"
+
+const int32_t LEVEL = 100000;   // steady input level
+const int32_t NOISE = 20000;    // mains interference amplitude
+
+static int32_t residual(MD_HX711_FilterNotch &n, uint8_t mains, double sps)
+// largest difference from the input level after the filter settles
+{
+  double period = 1e6 / sps;
+  int32_t mx = 0;
+
+  for (uint16_t i = 0; i < 3000; i++)
+  {
+    int32_t v = LEVEL + (int32_t)(NOISE * sin(2 * M_PI * mains * i / sps + 0.3));
+    int32_t d = n.apply(v, (uint32_t)(i * period)) - LEVEL;
+
+    if (i > 2000 && abs(d) > mx) mx = abs(d);
+  }
+
+  return(mx);
+}
+
+static void testKalman(void)
+// The rate estimate is zero for a constant load and follows a ramp
+{
+  const uint32_t PERIOD = 12500;    // 80 SPS
+  const int32_t SLOPE = 4000;       // ramp counts/s
+  MD_HX711_FilterKalman k(50, 2000);
+  uint32_t t = 0;
+  int32_t w = 0;
+
+  // constant load, with noise
+  for (uint16_t i = 0; i < 400; i++, t += PERIOD)
+  {
+    w = k.apply(LEVEL + ((i * 7919) % 101) - 50, t);
+    if (i == 0) CHECK_EQ(k.getRate(), 0);
+  }
+  CHECK(abs(w - LEVEL) < 10);
+  CHECK(abs(k.getRate()) < 50);    // noise of +/-50 counts
+
+  // ramp, the estimate settles on the slope and the weight follows
+  int32_t v = LEVEL;
+
+  for (uint16_t i = 0; i < 400; i++, t += PERIOD)
+  {
+    v = LEVEL + (int32_t)((int64_t)SLOPE * (i + 1) * PERIOD / 1000000);
+    w = k.apply(v, t);
+  }
+  CHECK(abs(k.getRate() - SLOPE) < SLOPE / 50);
+  CHECK(abs(w - v) < 20);
+
+  // uneven periods give the same rate
+  for (uint16_t i = 0; i < 400; i++)
+  {
+    t += (i & 1) ? PERIOD / 2 : 2 * PERIOD;
+    w = k.apply(LEVEL + (int32_t)((int64_t)SLOPE * t / 1000000), t);
+  }
+  CHECK(abs(k.getRate() - SLOPE) < SLOPE / 50);
+
+  // back to a constant load
+  for (uint16_t i = 0; i < 400; i++, t += PERIOD)
+    k.apply(LEVEL, t);
+  CHECK(abs(k.getRate()) < 20);
+}
+
+static void testDecimate(void)
+// Block means with fraction bits, and no change to the interrupt state
+{
+  static const struct { uint16_t size; uint8_t fracBits; } cfg[] = 
+  {
+    { 1, 0 }, { 2, 0 }, { 4, 1 }, { 8, 1 }, { 16, 2 }, { 64, 3 }, { 100, 3 },
+  };
+
+  for (uint8_t i = 0; i < sizeof(cfg) / sizeof(cfg[0]); i++)
+  {
+    MD_HX711_FilterDecimate d(cfg[i].size);
+
+    CHECK_EQ(d.getFracBits(), cfg[i].fracBits);
+  }
+
+  MD_HX711_FilterDecimate d(8);
+  MD_HX711_FilterDecimate::output_t out;
+
+  // block of 8 samples with mean 100.5, 1 fraction bit
+  for (uint8_t i = 0; i < 8; i++)
+  {
+    CHECK(!d.getOutput(out));
+    d.apply((i & 1) ? 101 : 100, 1000 * i);
+  }
+  CHECK(d.getOutput(out));
+  CHECK_EQ(out.value, 201);
+  CHECK_EQ(out.fracBits, 1);
+  CHECK_EQ(out.samples, 8);
+  CHECK_EQ(out.time, 7000);
+  CHECK_EQ(out.count, 1);
+  CHECK(!d.getOutput(out));
+
+  // called with interrupts disabled (setFilter() or the ISR), they stay disabled
+  MD_HX711_FilterKalman k;
+
+  noInterrupts();
+  d.reset();
+  d.getOutput(out);
+  k.getRate();
+  CHECK(MD_HX711_Host::irq().masked);
+  interrupts();
+}
+
+static void testMedian(void)
+// Spikes are removed and counted, and the output is the true median
+{
+  static const struct { uint8_t size, actual; } cfg[] = { { 0, 3 }, { 3, 3 }, { 4, 5 }, { 5, 5 }, { 7, 7 }, { 9, 7 } };
+
+  for (uint8_t i = 0; i < sizeof(cfg) / sizeof(cfg[0]); i++)
+  {
+    MD_HX711_FilterMedian m(cfg[i].size);
+
+    CHECK_EQ(m.getSize(), cfg[i].actual);
+  }
+
+  // single glitches (all ones, reading -1) and a pair of spikes in a window of 5
+  MD_HX711_FilterMedian m(5, 10000);
+
+  for (uint16_t i = 0; i < 100; i++)
+  {
+    int32_t v = LEVEL + (i & 3);
+
+    if (i == 20 || i == 50) v = -1;
+    if (i == 70 || i == 71) v = LEVEL + 500000;
+
+    int32_t out = m.apply(v, 0);
+
+    CHECK(out >= LEVEL && out <= LEVEL + 3);
+  }
+  CHECK_EQ(m.getRejected(), 4);
+  m.clearRejected();
+  CHECK_EQ(m.getRejected(), 0);
+
+  // the sorted window gives the median for any data
+  MD_HX711_FilterMedian m7(7);
+  int32_t hist[7];
+
+  srand(1);
+  for (uint16_t i = 0; i < 1000; i++)
+  {
+    int32_t v = (rand() % 2001) - 1000;
+
+    if (i == 0)
+      for (uint8_t j = 0; j < 7; j++) hist[j] = v;
+    else if (i % 50 == 0)
+      v = hist[(i + 6) % 7];    // repeated values
+    hist[i % 7] = v;
+
+    int32_t out = m7.apply(v, 0);
+    uint8_t below = 0, same = 0;
+
+    for (uint8_t j = 0; j < 7; j++)
+    {
+      if (hist[j] < out) below++;
+      if (hist[j] == out) same++;
+    }
+    if (!(same != 0 && below <= 3 && below + same > 3))
+      printf("median sample %u: %ld\n", i, (long)out);
+    CHECK(same != 0 && below <= 3 && below + same > 3);
+  }
+}
+
+static void testEMA(void)
+// Step response matches the exact exponential average
+{
+  for (uint8_t shift = 0; shift <= MD_HX711_FilterEMA::MAX_SHIFT; shift++)
+  {
+    MD_HX711_FilterEMA e(shift);
+    double ref = LEVEL;
+    int32_t out = 0;
+
+    CHECK_EQ(e.apply(LEVEL, 0), LEVEL);   // starts at the first sample
+    for (uint16_t i = 0; i < 2000; i++)
+    {
+      out = e.apply(LEVEL + 10000, 0);
+      ref += (LEVEL + 10000 - ref) / (1 << shift);
+      if (fabs(out - ref) > 1.0)
+      {
+        printf("EMA shift %u sample %u: %ld, expected %.1f\n", shift, i, (long)out, ref);
+        CHECK(false);
+        break;
+      }
+    }
+    CHECK_EQ(out, LEVEL + 10000);
+  }
+}
+
+static void testBiquad(void)
+// Butterworth low pass step response matches the exact filter
+{
+  MD_HX711_FilterBiquad b;
+
+  CHECK_EQ(b.apply(1234, 0), 1234);     // passes the data until set up
+  CHECK_EQ(b.apply(-5678, 0), -5678);
+  CHECK(!b.setLowPass(40.0, 80.0));
+  CHECK(!b.setLowPass(0.0, 80.0));
+  CHECK(b.setLowPass(2.0, 80.0));
+
+  // the same filter in floating point
+  double k = tan(M_PI * 2.0 / 80.0);
+  double norm = 1.0 / (1.0 + M_SQRT2 * k + k * k);
+  double b0 = k * k * norm, b1 = 2 * b0, b2 = b0;
+  double a1 = 2 * (k * k - 1) * norm, a2 = (1 - M_SQRT2 * k + k * k) * norm;
+  double x1 = LEVEL, x2 = LEVEL, y1 = LEVEL, y2 = LEVEL;
+  int32_t out = 0, peak = 0;
+  uint16_t rise = 0;
+
+  CHECK_EQ(b.apply(LEVEL, 0), LEVEL);   // starts at the first sample
+  for (uint16_t i = 0; i < 400; i++)
+  {
+    double x = LEVEL + 10000;
+    double y = b0 * x + b1 * x1 + b2 * x2 - a1 * y1 - a2 * y2;
+
+    x2 = x1; x1 = x; y2 = y1; y1 = y;
+    out = b.apply(LEVEL + 10000, 0);
+    if (fabs(out - y) > 1.0)
+    {
+      printf("biquad sample %u: %ld, expected %.1f\n", i, (long)out, y);
+      CHECK(false);
+      break;
+    }
+    if (out > peak) peak = out;
+    if (rise == 0 && out >= LEVEL + 5000) rise = i;
+  }
+  CHECK_EQ(out, LEVEL + 10000);               // unity gain at DC
+  CHECK(peak > LEVEL + 10300 && peak < LEVEL + 10500);   // 4.3% overshoot
+  CHECK(rise > 4 && rise < 12);               // about 0.1s at 2Hz
+
+  // small steps with heavy smoothing settle with no dead band
+  CHECK(b.setLowPass(0.1, 80.0));
+  b.apply(LEVEL, 0);
+  for (uint16_t i = 0; i < 5000; i++)
+    out = b.apply(LEVEL + 3, 0);
+  CHECK_EQ(out, LEVEL + 3);
+  for (uint16_t i = 0; i < 5000; i++)
+    out = b.apply(LEVEL + 1, 0);
+  CHECK_EQ(out, LEVEL + 1);
+}
+
+static void testAdaptive(void)
+// Smoothing increases while stable and a step gives the fastest response
+{
+  MD_HX711_FilterAdaptive a(1, 6);
+  int32_t out = 0, mx = 0;
+
+  CHECK_EQ(a.apply(LEVEL, 0), LEVEL);
+  CHECK_EQ(a.getShift(), 1);
+  CHECK(!a.isSettled());
+
+  // noisy stable load, settles to the maximum smoothing
+  srand(2);
+  for (uint16_t i = 0; i < 300; i++)
+  {
+    out = a.apply(LEVEL + (rand() % 41) - 20, 0);
+    if (i > 200 && abs(out - LEVEL) > mx) mx = abs(out - LEVEL);
+  }
+  CHECK(a.isSettled());
+  CHECK_EQ(a.getShift(), 6);
+  CHECK(mx <= 8);     // noise of +/-20 reduced
+
+  // a step is followed quickly, then the smoothing increases again
+  out = a.apply(LEVEL + 5000, 0);
+  CHECK_EQ(a.getShift(), 1);
+  CHECK(out > LEVEL + 2000);
+  for (uint8_t i = 0; i < 8; i++)
+    out = a.apply(LEVEL + 5000 + (rand() % 41) - 20, 0);
+  CHECK(abs(out - (LEVEL + 5000)) <= 20);
+  for (uint16_t i = 0; i < 300; i++)
+    a.apply(LEVEL + 5000 + (rand() % 41) - 20, 0);
+  CHECK(a.isSettled());
+
+  // a fixed threshold smooths changes below it
+  MD_HX711_FilterAdaptive f(1, 4, 100);
+
+  for (uint16_t i = 0; i < 100; i++)
+    f.apply(LEVEL, 0);
+  CHECK(f.isSettled());
+  out = f.apply(LEVEL + 80, 0);
+  CHECK(f.isSettled());
+  CHECK_EQ(out, LEVEL + 5);   // 80 / 16
+  f.apply(LEVEL + 200, 0);
+  CHECK_EQ(f.getShift(), 1);
+}
+
+int main(void)
+{
+  static const struct
+  {
+    uint8_t mains;
+    double sps;
+    uint16_t notch;   // expected notch frequency
+  } cfg[] = 
+  {
+    { 50, 80.0, 30 }, { 50, 80.6, 30 }, { 50, 79.2, 29 },
+    { 60, 80.0, 20 }, { 60, 80.6, 20 }, { 60, 79.2, 19 },
+  };
+
+  for (uint8_t i = 0; i < sizeof(cfg) / sizeof(cfg[0]); i++)
+  {
+    MD_HX711_FilterNotch n(cfg[i].mains);
+    int32_t r = residual(n, cfg[i].mains, cfg[i].sps);
+
+    CHECK_EQ(n.getNotchFrequency(), cfg[i].notch);
+    CHECK(r < NOISE / 200);
+  }
+
+  // at 10 SPS the alias is at 0Hz and the data is passed unchanged
+  MD_HX711_FilterNotch n(50);
+
+  residual(n, 50, 10.0);
+  CHECK_EQ(n.getNotchFrequency(), 0);
+  CHECK_EQ(n.apply(1234, 300000000UL), 1234);
+
+  testKalman();
+  testDecimate();
+  testMedian();
+  testEMA();
+  testBiquad();
+  testAdaptive();
+
+  return(testSummary("test_filter"));
+}
@@ -0,0 +1,105 @@
+// Host test reporting the longest time interrupts are disabled while reading
+// the HX711, with and without enableShortIRQMask(), and when stopping async mode.
+
+#include <MD_HX711.h>
+#include <MD_HX711_Sim.h>
+#include "test.h"
+
+struct result_t
+{
+  uint32_t masked;    // longest time interrupts disabled (us)
+  uint32_t clkHigh;   // longest CLK HIGH time (us)
+};
+
+static result_t measure(bool shortMask, bool chB, MD_HX711::mode_t gain)
+{
+  MD_HX711_Sim hx(MD_HX711_Sim::PERIOD_80SPS);
+  MD_HX711B<MD_HX711_SimBus> s((MD_HX711_SimBus(&hx)));
+  result_t r;
+
+  hx.setInput(false, 12345);
+  hx.setInput(true, -678);
+  s.begin();
+  s.enableShortIRQMask(shortMask);
+  s.enableChannelB(chB);
+  s.setGainA(gain);
+  hx.clearStats();
+  MD_HX711_Host::clearMaxMasked();
+
+  for (uint8_t i = 0; i < 10; i++)
+    s.read();
+
+  r.masked = MD_HX711_Host::getMaxMasked();
+  r.clkHigh = hx.getMaxClkHigh();
+  CHECK_EQ(hx.getErrors(), 0);
+
+  return(r);
+}
+
+static void testAsyncStop(void)
+// Stopping async mode part way through a read cycle finishes the cycle
+// with interrupts only disabled while CLK is high
+{
+  MD_HX711_Sim hx(MD_HX711_Sim::PERIOD_80SPS);
+  MD_HX711B<MD_HX711_SimBus> s((MD_HX711_SimBus(&hx)));
+
+  hx.setInput(false, 12345);
+  s.begin();
+  s.enableAsyncMode();
+
+  uint32_t count = s.getReadCount();
+  uint32_t edges = hx.getEdges();
+
+  // tick part way into a read cycle
+  while (hx.getEdges() - edges < 21)
+  {
+    delayMicroseconds(20);
+    s.asyncTick();
+  }
+  MD_HX711_Host::clearMaxMasked();
+  s.enableAsyncMode(false);
+
+  printf("async stop mask %lu us\n", (unsigned long)MD_HX711_Host::getMaxMasked());
+  CHECK(MD_HX711_Host::getMaxMasked() <= 1);
+  CHECK_EQ(s.getReadCount(), count + 1);
+  CHECK_EQ(s.getRaw(), 12345);
+  CHECK_EQ(hx.getErrors(), 0);
+}
+
+int main(void)
+{
+  static const struct
+  {
+    const char *name;
+    bool chB;
+    MD_HX711::mode_t gain;
+    uint8_t pulses;   // CLK pulses per read cycle
+  } cfg[] =
+  {
+    { "A128", false, MD_HX711::GAIN_128, 25 },
+    { "A64 ", false, MD_HX711::GAIN_64,  27 },
+    { "A/B ", true,  MD_HX711::GAIN_128, 26 },
+  };
+
+  printf("Longest interrupt mask and CLK HIGH time per read (us)\n");
+  printf("mode  default mask  short mask  CLK HIGH\n");
+  for (uint8_t i = 0; i < sizeof(cfg) / sizeof(cfg[0]); i++)
+  {
+    result_t full = measure(false, cfg[i].chB, cfg[i].gain);
+    result_t part = measure(true, cfg[i].chB, cfg[i].gain);
+
+    printf("%s  %12lu  %10lu  %8lu\n", cfg[i].name,
+      (unsigned long)full.masked, (unsigned long)part.masked, (unsigned long)full.clkHigh);
+
+    // default masks the whole read cycle, 2us for each CLK pulse
+    CHECK_EQ(full.masked, 2 * cfg[i].pulses);
+    // short mask only while CLK is HIGH
+    CHECK_EQ(part.masked, 1);
+    CHECK_EQ(part.clkHigh, full.clkHigh);
+    CHECK(full.clkHigh < MD_HX711_Sim::PD_TIME);
+  }
+
+  testAsyncStop();
+
+  return(testSummary("test_irqmask"));
+}
@@ -0,0 +1,832 @@
+// Host tests of the MD_HX711 library against the MD_HX711_Sim device model.
+//
+// Checks the channel sequencing, gain, missed conversion detection, tare,
+// asynchronous mode, sample buffer, callbacks, calibration and data filters.
+
+#include <math.h>
+#include <MD_HX711.h>
+#include <MD_HX711_Sim.h>
+#include <MD_HX711_Cal.h>
+#include <MD_HX711_Filter.h>
+#include "test.h"
+
+typedef MD_HX711B<MD_HX711_SimBus> scale_t;
+
+const int32_t IN_A = 100000;    // channel A input at gain 128
+const int32_t IN_B = -20000;    // channel B input
+
+static void setup(MD_HX711_Sim &hx, scale_t &s)
+{
+  hx.setInput(false, IN_A);
+  hx.setInput(true, IN_B);
+  hx.reset();
+  s.begin();
+  s.setSamplePeriod(MD_HX711::PERIOD_80SPS);
+}
+
+static void testChannelAB(void)
+// Channels A and B alternate when B is enabled
+{
+  MD_HX711_Sim hx(MD_HX711_Sim::PERIOD_80SPS);
+  scale_t s((MD_HX711_SimBus(&hx)));
+
+  setup(hx, s);
+  for (uint8_t i = 0; i < 3; i++)
+  {
+    CHECK_EQ(s.read(), MD_HX711::CH_A);
+    CHECK_EQ(s.getRaw(MD_HX711::CH_A), IN_A);
+  }
+
+  s.enableChannelB();
+  for (uint8_t i = 0; i < 8; i++)
+  {
+    MD_HX711::channel_t ch = s.read();
+
+    CHECK_EQ(ch, (i & 1) ? MD_HX711::CH_B : MD_HX711::CH_A);
+    CHECK_EQ(s.getRaw(ch), ch == MD_HX711::CH_A ? IN_A : IN_B);
+  }
+  CHECK_EQ(hx.getErrors(), 0);
+  CHECK_EQ(s.getMissedCount(MD_HX711::CH_A), 0);
+  CHECK_EQ(s.getMissedCount(MD_HX711::CH_B), 0);
+}
+
+static void testGain64(void)
+// Channel A gain 64 returns half the gain 128 value
+{
+  MD_HX711_Sim hx(MD_HX711_Sim::PERIOD_80SPS);
+  scale_t s((MD_HX711_SimBus(&hx)));
+
+  setup(hx, s);
+  s.read();
+  s.setGainA(MD_HX711::GAIN_64);
+  s.read();   // converted before the gain change took effect
+  for (uint8_t i = 0; i < 4; i++)
+  {
+    CHECK_EQ(s.read(), MD_HX711::CH_A);
+    CHECK_EQ(s.getRaw(), IN_A / 2);
+  }
+  CHECK_EQ(hx.getErrors(), 0);
+}
+
+static void testMissed(void)
+// Conversions not read in time are counted as missed
+{
+  MD_HX711_Sim hx(MD_HX711_Sim::PERIOD_80SPS);
+  scale_t s((MD_HX711_SimBus(&hx)));
+
+  setup(hx, s);
+  s.read();
+  s.read();
+  CHECK_EQ(s.getMissedCount(), 0);
+
+  delayMicroseconds(3 * MD_HX711_Sim::PERIOD_80SPS);   // 2 conversions are not read
+  s.read();
+  CHECK_EQ(s.getMissedCount(), 2);
+  s.read();
+  CHECK_EQ(s.getMissedCount(), 2);
+  CHECK_EQ(s.getRaw(), IN_A);
+}
+
+static void testTare(void)
+// Tare averages the readings for both channels
+{
+  MD_HX711_Sim hx(MD_HX711_Sim::PERIOD_80SPS);
+  scale_t s((MD_HX711_SimBus(&hx)));
+
+  setup(hx, s);
+  s.enableChannelB();
+  s.autoZeroTare(5);
+  CHECK(!s.isAutoZeroTareBusy());
+  CHECK_EQ(s.getZeroTare(MD_HX711::CH_A), IN_A);
+  CHECK_EQ(s.getZeroTare(MD_HX711::CH_B), IN_B);
+  CHECK_EQ(s.getZeroTareStdDev(MD_HX711::CH_A), 0);
+  CHECK_EQ(s.getZeroTareRejected(MD_HX711::CH_A), 0);
+
+  hx.setInput(false, IN_A + 1234);
+  s.read();
+  s.read();
+  CHECK_EQ(s.getTared(MD_HX711::CH_A), 1234);
+  CHECK_EQ(s.getTared(MD_HX711::CH_B), 0);
+}
+
+static void testTareGain(void)
+// Tare skips a conversion made before a gain change took effect
+{
+  MD_HX711_Sim hx(MD_HX711_Sim::PERIOD_80SPS);
+  scale_t s((MD_HX711_SimBus(&hx)));
+
+  setup(hx, s);
+  s.setGainA(MD_HX711::GAIN_64);
+  for (uint8_t i = 0; i < 3; i++)
+    s.read();
+  CHECK_EQ(s.getRaw(), IN_A / 2);
+
+  s.setGainA(MD_HX711::GAIN_128);
+  s.autoZeroTare(5);
+  CHECK_EQ(s.getZeroTare(MD_HX711::CH_A), IN_A);
+  CHECK_EQ(s.getZeroTare(MD_HX711::CH_B), IN_B);
+  CHECK_EQ(s.getZeroTareStdDev(MD_HX711::CH_A), 0);
+}
+
+static uint32_t glitchA;    // bit n set for a glitch on channel A conversion n
+static uint8_t convA;       // channel A conversion count
+
+static int32_t glitchSource(bool chB, uint32_t)
+{
+  if (chB) return(IN_B);
+  return(IN_A + ((glitchA >> (convA++ & 31)) & 1 ? 50000 : 0));
+}
+
+static void testTareNoise(void)
+// Tare rejects noise and restarts on consecutive rejections
+{
+  MD_HX711_Sim hx(MD_HX711_Sim::PERIOD_80SPS);
+  scale_t s((MD_HX711_SimBus(&hx)));
+
+  setup(hx, s);
+  hx.setSource(glitchSource);
+  s.setAutoZeroTareLimit(1000);
+
+  // isolated glitches are rejected
+  glitchA = 0x54;   // 2, 4, 6
+  convA = 0;
+  s.autoZeroTare(5);
+  CHECK_EQ(s.getZeroTare(MD_HX711::CH_A), IN_A);
+  CHECK_EQ(s.getZeroTareRejected(MD_HX711::CH_A), 3);
+  CHECK_EQ(s.getZeroTareRejected(MD_HX711::CH_B), 0);
+
+  // only consecutive rejections count towards a restart
+  glitchA = 0x1a;   // 1, 3, 4
+  convA = 0;
+  s.autoZeroTare(5);
+  CHECK_EQ(s.getZeroTare(MD_HX711::CH_A), IN_A);
+  CHECK_EQ(s.getZeroTareRejected(MD_HX711::CH_A), 3);
+
+  // noisy reference, the first accepted sample is later rejected
+  glitchA = 0x01;   // 0
+  convA = 0;
+  s.autoZeroTare(5);
+  CHECK_EQ(s.getZeroTare(MD_HX711::CH_A), IN_A);
+  CHECK_EQ(s.getZeroTareRejected(MD_HX711::CH_A), 2);
+  CHECK_EQ(s.getZeroTareStdDev(MD_HX711::CH_A), 0);
+}
+
+static void testAsync(void)
+// Asynchronous mode reads the same data with no protocol errors
+{
+  MD_HX711_Sim hx(MD_HX711_Sim::PERIOD_80SPS);
+  scale_t s((MD_HX711_SimBus(&hx)));
+
+  setup(hx, s);
+  s.enableChannelB();
+  s.enableAsyncMode();
+  CHECK(s.isAsyncMode());
+
+  uint32_t count = s.getReadCount();
+  uint32_t end = micros() + 80 * MD_HX711_Sim::PERIOD_80SPS;  // A/B switch settles in 4 periods
+
+  while ((int32_t)(micros() - end) < 0)
+  {
+    delayMicroseconds(20);
+    s.asyncTick();
+    if (s.getReadCount() != count)
+    {
+      MD_HX711::channel_t ch = s.read();    // returns immediately in async mode
+
+      count = s.getReadCount();
+      CHECK_EQ(s.getRaw(ch), ch == MD_HX711::CH_A ? IN_A : IN_B);
+    }
+  }
+  s.enableAsyncMode(false);
+
+  CHECK(count >= 16);
+  CHECK_EQ(hx.getErrors(), 0);
+  CHECK(hx.getMaxClkHigh() < MD_HX711_Sim::PD_TIME);
+  CHECK_EQ(s.getMissedCount(MD_HX711::CH_A), 0);
+  CHECK_EQ(s.getMissedCount(MD_HX711::CH_B), 0);
+}
+
+static void tickToMidCycle(MD_HX711_Sim &hx, scale_t &s)
+// advance the async read until it is part way through a read cycle
+{
+  uint32_t edges = hx.getEdges();
+
+  while (hx.getEdges() - edges < 20)
+  {
+    delayMicroseconds(20);
+    s.asyncTick();
+  }
+}
+
+static uint32_t tickToRead(scale_t &s)
+// advance the async read until the next sample is saved
+{
+  uint32_t count = s.getReadCount();
+
+  while (s.getReadCount() == count)
+  {
+    delayMicroseconds(20);
+    s.asyncTick();
+  }
+
+  return(s.getReadCount());
+}
+
+static void testAsyncChannelChange(void)
+// Data is saved to the channel it was converted from when channel 
+// B is enabled or disabled part way through a read cycle
+{
+  MD_HX711_Sim hx(MD_HX711_Sim::PERIOD_80SPS);
+  scale_t s((MD_HX711_SimBus(&hx)));
+
+  setup(hx, s);
+  s.enableAsyncMode();
+  tickToRead(s);
+
+  tickToMidCycle(hx, s);
+  s.enableChannelB();
+  tickToRead(s);
+  CHECK_EQ(s.read(), MD_HX711::CH_A);
+  CHECK_EQ(s.getRaw(MD_HX711::CH_A), IN_A);
+  CHECK_EQ(s.getRaw(MD_HX711::CH_B), 0);
+
+  tickToRead(s);
+  CHECK_EQ(s.read(), MD_HX711::CH_A);   // B was selected by this read
+  tickToRead(s);
+  CHECK_EQ(s.read(), MD_HX711::CH_B);
+  CHECK_EQ(s.getRaw(MD_HX711::CH_B), IN_B);
+
+  // B selected for the next conversion, A being read
+  tickToMidCycle(hx, s);
+  s.enableChannelB(false);
+  tickToRead(s);
+  CHECK_EQ(s.read(), MD_HX711::CH_A);
+  tickToRead(s);
+  CHECK_EQ(s.read(), MD_HX711::CH_B);   // already selected
+  for (uint8_t i = 0; i < 3; i++)
+  {
+    tickToRead(s);
+    CHECK_EQ(s.read(), MD_HX711::CH_A);
+    CHECK_EQ(s.getRaw(MD_HX711::CH_A), IN_A);
+  }
+  CHECK_EQ(s.getRaw(MD_HX711::CH_B), IN_B);
+
+  // tare started part way through a read cycle
+  hx.setInput(false, IN_A + 10);
+  hx.setInput(true, IN_B + 10);
+  tickToMidCycle(hx, s);
+  s.autoZeroTareStart(4);
+  while (s.isAutoZeroTareBusy())
+  {
+    delayMicroseconds(20);
+    s.asyncTick();
+  }
+  CHECK_EQ(s.getZeroTare(MD_HX711::CH_A), IN_A + 10);
+  CHECK_EQ(s.getZeroTare(MD_HX711::CH_B), IN_B + 10);
+  CHECK_EQ(hx.getErrors(), 0);
+}
+
+static MD_HX711::sample_t cbLast;
+static uint16_t cbCount;
+
+static void callback(MD_HX711Base &, const MD_HX711::sample_t &s)
+{
+  cbLast = s;
+  cbCount++;
+}
+
+static void testBuffer(void)
+// Samples are queued in order and overflow is counted
+{
+  MD_HX711_Sim hx(MD_HX711_Sim::PERIOD_80SPS);
+  scale_t s((MD_HX711_SimBus(&hx)));
+  MD_HX711::sample_t buf[8], x;
+
+  setup(hx, s);
+  CHECK(!s.setBuffer(buf, 6));    // not a power of 2
+  CHECK(s.setBuffer(buf, 8));
+  s.enableChannelB();
+
+  for (uint8_t i = 0; i < 10; i++)
+    s.read();
+  CHECK_EQ(s.available(), 8);
+  CHECK_EQ(s.getOverflowCount(), 2);
+
+  uint32_t last = 0;
+  for (uint8_t i = 0; i < 8; i++)
+  {
+    CHECK(s.pop(x));
+    CHECK_EQ(x.ch, (i & 1) ? MD_HX711::CH_B : MD_HX711::CH_A);
+    CHECK_EQ(x.raw, x.ch == MD_HX711::CH_A ? IN_A : IN_B);
+    if (i != 0) CHECK(x.time > last);
+    last = x.time;
+  }
+  CHECK(!s.pop(x));
+  CHECK_EQ(s.available(), 0);
+}
+
+static void testCallback(void)
+// Immediate and deferred callbacks see every sample
+{
+  MD_HX711_Sim hx(MD_HX711_Sim::PERIOD_80SPS);
+  scale_t s((MD_HX711_SimBus(&hx)));
+  MD_HX711::sample_t buf[4];
+
+  setup(hx, s);
+  s.enableChannelB();
+
+  // immediate
+  cbCount = 0;
+  s.setCallback(callback, true);
+  for (uint8_t i = 0; i < 5; i++)
+  {
+    MD_HX711::channel_t ch = s.read();
+
+    CHECK_EQ(cbCount, i + 1);
+    CHECK_EQ(cbLast.ch, ch);
+    CHECK_EQ(cbLast.raw, s.getRaw(ch));
+    CHECK_EQ(cbLast.time, s.getTimestamp(ch));
+  }
+
+  // deferred, no buffer - latest sample passed on by service()
+  cbCount = 0;
+  s.setCallback(callback);
+  for (uint8_t i = 0; i < 5; i++)
+  {
+    MD_HX711::channel_t ch = s.read();
+
+    CHECK_EQ(cbCount, i);
+    s.service();
+    CHECK_EQ(cbCount, i + 1);
+    CHECK_EQ(cbLast.ch, ch);
+    s.service();    // nothing new
+    CHECK_EQ(cbCount, i + 1);
+  }
+
+  // deferred with buffer - all the queued samples passed on
+  cbCount = 0;
+  s.setBuffer(buf, 4);
+  s.read();
+  s.read();
+  s.read();
+  CHECK_EQ(cbCount, 0);
+  s.service();
+  CHECK_EQ(cbCount, 3);
+  CHECK_EQ(s.available(), 0);
+
+  // polled service() reads the device when data is ready
+  cbCount = 0;
+  for (uint32_t i = 0; i < 40 * MD_HX711_Sim::PERIOD_80SPS / 100; i++)
+  {
+    delayMicroseconds(100);
+    s.service();
+  }
+  CHECK(cbCount >= 9 && cbCount <= 10);
+  CHECK_EQ(hx.getErrors(), 0);
+}
+
+static int32_t setRaw(MD_HX711_Sim &hx, scale_t &s, int32_t v)
+// set the channel A input and read until the device returns it
+{
+  hx.setInput(false, v);
+  s.read();
+  s.read();
+
+  return(s.getRaw());
+}
+
+// Calibrations and data, including the ends of the 24 bit range
+static const struct
+{
+  int32_t tare;
+  int32_t calib;
+  float range;
+} calCase[] =
+{
+  { 0, 200000, 1000.0 }, { 1000, 201000, 5.0 }, { -0x800000L, 0x7fffffL, 30000.0 },
+  { 50000, 50100, 0.25 }, { 0, -100000, 1000.0 }, { 100, 200100, -500.0 },
+};
+
+static const int32_t calRaw[] = { -0x800000L, -0x7fffffL, -123457, -1, 0, 1, 99999, 0x7fffffL };
+
+static bool nearFixed(int32_t v, double ref)
+// v is ref rounded, allowing for the 31 bit scale factor, or limited to the int32_t range
+{
+  if (ref >= 2147483647.0) return(v == 0x7fffffffL);
+  if (ref <= -2147483647.0) return(v == -0x7fffffffL);
+
+  return(fabs(v - ref) <= 0.5 + fabs(ref) / (1L << 29));
+}
+
+static void testCalFixed(void)
+// Fixed point and float calibrated values match the exact value
+{
+  MD_HX711_Sim hx(MD_HX711_Sim::PERIOD_80SPS);
+  scale_t s((MD_HX711_SimBus(&hx)));
+
+  setup(hx, s);
+  CHECK(isnan(s.getCalibrated()));
+  CHECK_EQ(s.getCalibratedFixed(), MD_HX711::CALIB_INVALID);
+
+  for (uint8_t i = 0; i < sizeof(calCase) / sizeof(calCase[0]); i++)
+  {
+    s.setZeroTare(calCase[i].tare);
+    s.setCalibration(calCase[i].calib, calCase[i].range);
+
+    for (uint8_t j = 0; j < sizeof(calRaw) / sizeof(calRaw[0]); j++)
+    {
+      CHECK_EQ(setRaw(hx, s, calRaw[j]), calRaw[j]);
+
+      double ref = (double)(calRaw[j] - calCase[i].tare) * calCase[i].range / (calCase[i].calib - calCase[i].tare);
+      float f = s.getCalibrated();
+      int32_t q = s.getCalibratedFixed();
+
+      CHECK(fabs(f - ref) <= fabs(ref) * 1e-6 + 1e-6);
+      if (!nearFixed(q, ref * 65536))
+        printf("case %u raw %ld: fixed %ld, expected %.1f\n", i, (long)calRaw[j], (long)q, ref * 65536);
+      CHECK(nearFixed(q, ref * 65536));
+    }
+  }
+
+  // the cached scale factor follows a tare change
+  s.setCalibration(200000, 1000.0);
+  s.setZeroTare(0);
+  setRaw(hx, s, 100000);
+  CHECK_EQ(s.getCalibratedFixed(), 500L * 65536);
+  s.setZeroTare(-200000);
+  CHECK_EQ(s.getCalibratedFixed(), 750L * 65536);
+}
+
+static void testCalInt(void)
+// Integer calibrated values in application units match the exact value
+{
+  static const uint32_t unit[] = { 1, 10, 1000, 1000000UL, 0xffffffffUL };
+  MD_HX711_Sim hx(MD_HX711_Sim::PERIOD_80SPS);
+  scale_t s((MD_HX711_SimBus(&hx)));
+
+  setup(hx, s);
+  CHECK_EQ(s.getCalibratedInt(), MD_HX711::CALIB_INVALID);
+
+  for (uint8_t i = 0; i < sizeof(calCase) / sizeof(calCase[0]); i++)
+  {
+    s.setZeroTare(calCase[i].tare);
+    s.setCalibration(calCase[i].calib, calCase[i].range);
+
+    for (uint8_t j = 0; j < sizeof(calRaw) / sizeof(calRaw[0]); j++)
+    {
+      setRaw(hx, s, calRaw[j]);
+
+      double ref = (double)(calRaw[j] - calCase[i].tare) * calCase[i].range / (calCase[i].calib - calCase[i].tare);
+
+      for (uint8_t k = 0; k < sizeof(unit) / sizeof(unit[0]); k++)
+      {
+        int32_t v = s.getCalibratedInt(MD_HX711::CH_A, unit[k]);
+
+        if (!nearFixed(v, ref * unit[k]))
+          printf("case %u raw %ld unit %lu: %ld, expected %.1f\n", i, (long)calRaw[j], (unsigned long)unit[k], (long)v, ref * unit[k]);
+        CHECK(nearFixed(v, ref * unit[k]));
+      }
+    }
+  }
+
+  // the integer range gives the same calibration as the float range
+  for (uint8_t i = 0; i < sizeof(calCase) / sizeof(calCase[0]); i++)
+  {
+    if (calCase[i].range != (int32_t)calCase[i].range) continue;
+
+    s.setZeroTare(calCase[i].tare);
+    s.setCalibration(calCase[i].calib, calCase[i].range);
+    setRaw(hx, s, 654321);
+
+    int32_t v = s.getCalibratedInt(MD_HX711::CH_A, 1000);
+
+    s.setCalibrationInt(calCase[i].calib, (int32_t)calCase[i].range);
+    CHECK_EQ(s.getCalibratedInt(MD_HX711::CH_A, 1000), v);
+  }
+
+  // buffered samples are converted with the calibration for their channel
+  MD_HX711::sample_t buf[8];
+  int32_t value[8];
+
+  s.setBuffer(buf, 8);
+  s.enableChannelB();
+  s.setZeroTare(1000, MD_HX711::CH_A);
+  s.setCalibration(201000, 5.0, MD_HX711::CH_A);
+  s.setZeroTare(-20000, MD_HX711::CH_B);
+  s.setCalibration(-40000, 2.0, MD_HX711::CH_B);
+  hx.setInput(false, 151000);
+  hx.setInput(true, -30000);
+  s.read();
+  s.read();
+  while (s.available() != 0) s.popBatch(buf, 8);
+  for (uint8_t i = 0; i < 6; i++)
+    s.read();
+
+  uint8_t n = s.popBatch(buf, 8);
+
+  CHECK_EQ(n, 6);
+  s.calibrateBatch(buf, value, n, 1000);
+  for (uint8_t i = 0; i < n; i++)
+  {
+    CHECK_EQ(value[i], s.getCalibratedInt(buf[i].ch, 1000));
+    CHECK_EQ(value[i], buf[i].ch == MD_HX711::CH_A ? 3750 : 1000);
+  }
+}
+
+static double interpolate(const int32_t *x, const int32_t *y, uint8_t n, int32_t t)
+// expected piecewise linear value, extended from the end segments
+{
+  uint8_t i = 0;
+
+  while (i < n - 2 && t >= x[i + 1]) i++;
+
+  return(y[i] + (double)(t - x[i]) * (y[i + 1] - y[i]) / (x[i + 1] - x[i]));
+}
+
+static void checkTable(MD_HX711_CalTable &table, const int32_t *x, const int32_t *y, uint8_t n)
+{
+  for (uint8_t i = 0; i < n; i++)
+    CHECK_EQ(table.calibrate(x[i]), y[i]);
+
+  for (int32_t t = x[0] - 50000; t <= x[n - 1] + 50000; t += 1237)
+  {
+    double ref = interpolate(x, y, n, t);
+    int32_t v = table.calibrate(t);
+
+    if (fabs(v - ref) > 0.5 + 1e-6)
+      printf("table at %ld: %ld, expected %.2f\n", (long)t, (long)v, ref);
+    CHECK(fabs(v - ref) <= 0.5 + 1e-6);
+  }
+}
+
+static void testCalTable(void)
+// Piecewise linear calibration, blob save and load
+{
+  const int32_t x[] = { -20000, 0, 104000, 209000, 316000, 430000 };
+  const int32_t y[] = { -97, 0, 500, 1000, 1500, 2000 };
+  const uint8_t N = sizeof(x) / sizeof(x[0]);
+  MD_HX711_CalTable::point_t pts[N], pts2[N + 2];
+  MD_HX711_CalTable table(pts, N), table2(pts2, N + 2);
+
+  CHECK_EQ(table.calibrate(0), MD_HX711::CALIB_INVALID);
+  CHECK(table.addPoint(x[0], y[0]));
+  CHECK_EQ(table.calibrate(0), MD_HX711::CALIB_INVALID);
+  CHECK(!table.addPoint(x[0], y[0]));    // raw not increasing
+  for (uint8_t i = 1; i < N; i++)
+    CHECK(table.addPoint(x[i], y[i]));
+  CHECK(!table.addPoint(500000, 2500));  // full
+  CHECK_EQ(table.getCount(), N);
+  CHECK(!table.isUniform());
+  checkTable(table, x, y, N);
+
+  // blob round trip into a different size table
+  uint8_t blob[1 + N * MD_HX711_CalTable::BLOB_POINT];
+
+  CHECK_EQ(table.getBlobSize(), sizeof(blob));
+  CHECK_EQ(table.save(blob, sizeof(blob) - 1), 0);
+  CHECK_EQ(table.save(blob, sizeof(blob)), sizeof(blob));
+  CHECK(!table2.load(blob, sizeof(blob) - 1));
+  CHECK(table2.load(blob, sizeof(blob)));
+  CHECK_EQ(table2.getCount(), N);
+  for (uint8_t i = 0; i < N; i++)
+  {
+    int32_t r, v;
+
+    CHECK(table2.getPoint(i, r, v));
+    CHECK_EQ(r, x[i]);
+    CHECK_EQ(v, y[i]);
+  }
+  checkTable(table2, x, y, N);
+
+  MD_HX711_CalTable::point_t small[2];
+  MD_HX711_CalTable table3(small, 2);
+
+  CHECK(!table3.load(blob, sizeof(blob)));    // too many points
+
+  // evenly spaced points find the segment directly
+  const int32_t xu[] = { 0, 70000, 140000, 210000, 280000 };
+  const int32_t yu[] = { 0, 333, 670, 1010, 1355 };
+
+  table2.clear();
+  for (uint8_t i = 0; i < 5; i++)
+    table2.addPoint(xu[i], yu[i]);
+  CHECK(table2.isUniform());
+  checkTable(table2, xu, yu, 5);
+
+  // used by the calibrated data methods
+  MD_HX711_Sim hx(MD_HX711_Sim::PERIOD_80SPS);
+  scale_t s((MD_HX711_SimBus(&hx)));
+
+  setup(hx, s);
+  s.setZeroTare(5000);
+  s.setCalCurve(&table);
+  setRaw(hx, s, 5000 + 156500);
+  CHECK_EQ(s.getCalibratedInt(), 750);
+  CHECK_EQ(s.getCalibratedInt(MD_HX711::CH_A, 1000), 750000);
+  CHECK_EQ(s.getCalibratedFixed(), 750L * 65536);
+  CHECK(s.getCalibrated() == 750.0);
+}
+
+static double quadratic(int32_t x)
+{
+  return(3.0 + 0.005 * x - 2e-9 * (double)x * x);
+}
+
+static void testCalPoly(void)
+// Polynomial calibration, set directly and fitted to a known quadratic
+{
+  MD_HX711_CalPoly poly, poly2;
+
+  // value = 1000 * (0.5u + 0.25u^2), u = tared / 2^20
+  const int32_t c[] = { 0, 1L << 27, 1L << 26 };
+
+  CHECK_EQ(poly.calibrate(0), MD_HX711::CALIB_INVALID);
+  CHECK(!poly.set(0, c, 20, 1000));
+  CHECK(!poly.set(MD_HX711_CalPoly::MAX_ORDER + 1, c, 20, 1000));
+  CHECK(poly.set(2, c, 20, 1000));
+  CHECK_EQ(poly.calibrate(0), 0);
+  CHECK_EQ(poly.calibrate(1L << 20), 750);
+  CHECK_EQ(poly.calibrate(-(1L << 20)), -250);
+  CHECK_EQ(poly.calibrate(1L << 18), 141);    // 125 + 15.625 rounded
+
+  // fit points on a quadratic, over a range larger than a power of 2
+  int32_t raw[9], value[9];
+
+  for (uint8_t i = 0; i < 9; i++)
+  {
+    raw[i] = -20000 + i * 50000;
+    value[i] = (int32_t)floor(quadratic(raw[i]) + 0.5);
+  }
+  CHECK(!poly.fit(raw, value, 2, 2));     // too few points
+  CHECK(poly.fit(raw, value, 9, 2));
+  CHECK_EQ(poly.getOrder(), 2);
+  for (int32_t t = -20000; t <= 380000; t += 997)
+  {
+    int32_t v = poly.calibrate(t);
+
+    if (fabs(v - quadratic(t)) > 1.0)
+      printf("poly at %ld: %ld, expected %.2f\n", (long)t, (long)v, quadratic(t));
+    CHECK(fabs(v - quadratic(t)) <= 1.0);
+  }
+
+  // the coefficients can be worked out elsewhere and set
+  int32_t coeff[MD_HX711_CalPoly::MAX_ORDER + 1];
+
+  for (uint8_t k = 0; k <= poly.getOrder(); k++)
+    coeff[k] = poly.getCoeff(k);
+  CHECK(poly2.set(poly.getOrder(), coeff, poly.getXShift(), poly.getYSpan()));
+  for (int32_t t = -20000; t <= 380000; t += 9973)
+    CHECK_EQ(poly2.calibrate(t), poly.calibrate(t));
+
+  // a higher order fits the same curve
+  CHECK(poly.fit(raw, value, 9, 4));
+  for (int32_t t = -20000; t <= 380000; t += 997)
+    CHECK(fabs(poly.calibrate(t) - quadratic(t)) <= 1.0);
+
+  // repeated raw values cannot be fitted
+  int32_t rawSame[] = { 1000, 1000, 1000, 1000 };
+
+  CHECK(!poly2.fit(rawSame, value, 4, 2));
+}
+
+// Filter recording the values it is given, passing them on unchanged
+class RecordFilter : public MD_HX711_Filter
+{
+public:
+  RecordFilter(void) : n(0) {}
+
+  int32_t v[16];    // values seen
+  uint8_t n;        // number of values seen
+
+  virtual void reset(void) { n = 0; }
+  virtual int32_t apply(int32_t value, uint32_t) { if (n < 16) v[n++] = value; return(value); }
+};
+
+static uint8_t spikeA;    // channel A conversion count
+
+static int32_t spikeSource(bool chB, uint32_t)
+// channel A input with a glitch on conversion 4
+{
+  if (chB) return(IN_B);
+  return(spikeA++ == 4 ? -1 : IN_A);
+}
+
+static void testPreFilter(void)
+// The prefilter output replaces the raw data, and is what the data filter,
+// sample buffer and callback receive
+{
+  MD_HX711_Sim hx(MD_HX711_Sim::PERIOD_80SPS);
+  scale_t s((MD_HX711_SimBus(&hx)));
+  MD_HX711_FilterMedian median(3, 1000);
+  RecordFilter before, after;
+  MD_HX711::sample_t buf[16], x;
+
+  setup(hx, s);
+  hx.setSource(spikeSource);
+  s.read();
+  s.read();
+  spikeA = 0;
+
+  s.setPreFilter(&median);
+  s.setFilter(&after);
+  s.setBuffer(buf, 16);
+  s.setCallback(callback, true);
+  cbCount = 0;
+  for (uint8_t i = 0; i < 8; i++)
+  {
+    s.read();
+    CHECK_EQ(s.getRaw(), IN_A);
+    CHECK_EQ(cbLast.raw, IN_A);
+  }
+  CHECK_EQ(median.getRejected(), 1);
+  CHECK_EQ(cbCount, 8);
+  CHECK_EQ(after.n, 8);
+  for (uint8_t i = 0; i < after.n; i++)
+  {
+    CHECK_EQ(after.v[i], IN_A);
+    CHECK(s.pop(x));
+    CHECK_EQ(x.raw, IN_A);
+  }
+
+  // the prefilter sees the data as read
+  s.setPreFilter(&before);
+  s.setBuffer(nullptr, 0);
+  for (uint8_t i = 0; i < 4; i++)
+    s.read();
+  CHECK_EQ(before.n, 4);
+  CHECK_EQ(before.v[0], IN_A);
+  spikeA = 4;
+  s.read();
+  CHECK_EQ(before.v[4], -1);
+  CHECK_EQ(after.v[12], -1);
+  CHECK_EQ(s.getRaw(), -1);
+
+  // the channels have separate filters
+  s.enableChannelB();
+  for (uint8_t i = 0; i < 4; i++)
+    s.read();
+  CHECK_EQ(before.n, 7);
+  CHECK_EQ(after.n, 15);
+  CHECK_EQ(s.getRaw(MD_HX711::CH_B), IN_B);
+  CHECK_EQ(s.getFiltered(MD_HX711::CH_B), IN_B);
+}
+
+static void testFilterStart(void)
+// A filter set before the first read starts from the first sample
+{
+  int32_t avgBuf[8];
+  MD_HX711_FilterAvg avg(avgBuf, 8);
+  MD_HX711_FilterDecimate decim(4);
+  MD_HX711_FilterKalman kalman(50, 2000);
+  MD_HX711_Filter *f[] = { &avg, &decim, &kalman };
+
+  for (uint8_t i = 0; i < sizeof(f) / sizeof(f[0]); i++)
+  {
+    MD_HX711_Sim hx(MD_HX711_Sim::PERIOD_80SPS);
+    scale_t s((MD_HX711_SimBus(&hx)));
+
+    hx.setInput(false, IN_A);
+    hx.reset();
+    s.begin();
+    s.setSamplePeriod(MD_HX711::PERIOD_80SPS);
+    s.setFilter(f[i]);
+    CHECK_EQ(s.getFiltered(), 0);
+
+    s.read();
+    CHECK_EQ(s.getFiltered(), IN_A);
+    for (uint8_t j = 0; j < 7; j++)
+    {
+      s.read();
+      CHECK_EQ(s.getFiltered(), IN_A);
+    }
+  }
+
+  MD_HX711_FilterDecimate::output_t out;
+
+  CHECK(decim.getOutput(out));
+  CHECK_EQ(out.value, IN_A * (1L << out.fracBits));
+  CHECK_EQ(out.count, 2);
+  CHECK_EQ(kalman.getRate(), 0);
+}
+
+int main(void)
+{
+  testChannelAB();
+  testGain64();
+  testMissed();
+  testTare();
+  testTareGain();
+  testTareNoise();
+  testAsync();
+  testAsyncChannelChange();
+  testBuffer();
+  testCallback();
+  testCalFixed();
+  testCalInt();
+  testCalTable();
+  testCalPoly();
+  testPreFilter();
+  testFilterStart();
+
+  return(testSummary("test_sim"));
+}
@@ -0,0 +1,135 @@
+// Host stress test of the consistent data reads (getSnapshot() and the
+// sequence counter) while new data is being saved.
+//
+// A thread stands in for the ISR, reading samples as fast as possible while
+// the main thread checks the data copies. Each sample has a raw value and
+// timestamp equal to the number of samples read, so any mix of data from
+// different samples shows up as a mismatch.
+//
+// Both threads yield regularly so that they interleave on a single core.
+// The writer also yields from inside the update window, using a filter.
+
+#include <thread>
+#include <atomic>
+#include <MD_HX711.h>
+#include <MD_HX711_Filter.h>
+#include "test.h"
+
+const uint32_t SAMPLES = 60000;    // overflow count does not wrap
+
+// Samples returned by the test bus and time source
+static volatile uint32_t sampleNum = 0;   // current sample number
+static volatile uint8_t pulses = 0;       // CLK pulses in this read cycle
+
+static unsigned long sampleTime(void)
+// called as each read cycle starts, so it selects the next sample
+{
+  pulses = 0;
+  return(++sampleNum);
+}
+
+// Bus returning the current sample number as the data
+class TestBus
+{
+public:
+  inline uint8_t pinClk(void) const { return(UINT8_MAX); }
+  inline uint8_t pinDat(void) const { return(UINT8_MAX); }
+  inline void begin(void) {}
+  inline void clkHigh(void) { pulses++; }
+  inline void clkLow(void) {}
+  inline bool datHigh(void) { return(pulses >= 1 && pulses <= 24 && ((sampleNum >> (24 - pulses)) & 1)); }
+};
+
+// Filter that gives up the processor part way through saving a sample
+class YieldFilter : public MD_HX711_Filter
+{
+public:
+  YieldFilter(void) : _n(0) {}
+  virtual void reset(void) {}
+  virtual int32_t apply(int32_t value, uint32_t) { if ((++_n & 0xff) == 0) std::this_thread::yield(); return(value); }
+
+private:
+  uint32_t _n;
+};
+
+static MD_HX711B<TestBus> scale;
+static YieldFilter filter;
+static std::atomic<bool> start(false), done(false);
+
+static void isr(void)
+// read the device continuously, as the ISR would
+{
+  while (!start) { }
+  for (uint32_t i = 0; i < SAMPLES; i++)
+  {
+    scale.read();
+    if ((i & 7) == 0) std::this_thread::yield();
+  }
+  done = true;
+}
+
+int main(void)
+{
+  MD_HX711::sample_t buf[4];
+  uint32_t checks = 0, lastCount = 0;
+  uint16_t lastOverflow = 0;
+  uint32_t bad = 0;
+
+  scale.begin();
+  scale.setTimeSource(sampleTime);
+  scale.setSamplePeriod(0);     // no missed conversion checks
+  scale.setBuffer(buf, 4);      // never emptied, so it overflows
+  scale.enableChannelB();
+  scale.setFilter(&filter, MD_HX711::CH_A);
+  scale.setFilter(&filter, MD_HX711::CH_B);
+  sampleNum = 0;
+
+  std::thread t(isr);
+
+  start = true;
+  while (!done)
+  {
+    MD_HX711::snapshot_t s;
+    MD_HX711::channel_t ch = (checks & 1) ? MD_HX711::CH_B : MD_HX711::CH_A;
+
+    scale.getSnapshot(s, ch);
+    if (s.count != 0 && (s.ch != ch || (uint32_t)s.raw != s.time || s.count != s.time))
+    {
+      if (bad++ < 5)
+        printf("inconsistent snapshot ch %d: raw %ld count %lu time %lu\n",
+          ch, (long)s.raw, (unsigned long)s.count, (unsigned long)s.time);
+    }
+
+    uint32_t count = scale.getReadCount();
+    uint16_t overflow = scale.getOverflowCount();
+
+    if (count < lastCount || overflow < lastOverflow)
+    {
+      if (bad++ < 5)
+        printf("counter went backwards: count %lu to %lu, overflow %u to %u\n",
+          (unsigned long)lastCount, (unsigned long)count, lastOverflow, overflow);
+    }
+    lastCount = count;
+    lastOverflow = overflow;
+    checks++;
+    std::this_thread::yield();
+  }
+  t.join();
+
+  CHECK_EQ(bad, 0);
+  CHECK(checks > 1000);
+  CHECK_EQ(scale.getReadCount(), SAMPLES);
+  CHECK_EQ(scale.getOverflowCount(), SAMPLES - 4);
+
+  // each channel records the read count of its own latest sample
+  MD_HX711::snapshot_t a, b;
+
+  scale.getSnapshot(a, MD_HX711::CH_A);
+  scale.getSnapshot(b, MD_HX711::CH_B);
+  CHECK_EQ(a.count, SAMPLES - 1);
+  CHECK_EQ(a.raw, SAMPLES - 1);
+  CHECK_EQ(b.count, SAMPLES);
+  CHECK_EQ(b.raw, SAMPLES);
+
+  return(testSummary("test_snapshot"));
+}